@@ -0,0 +1,25 @@
+-- Script to migate from db version 28 to 29.
+-- Added aggregated play counts, so stats and charts don't have to scan playback_log
+
+CREATE INDEX playback_log_playtime ON playback_log(playtime);
+
+-- play counts per source and track, kept up to date by DatabaseCommand_LogPlayback
+-- so charts and stats don't have to scan the playback_log
+CREATE TABLE IF NOT EXISTS playback_stats (
+    source INTEGER REFERENCES source(id) ON DELETE CASCADE ON UPDATE CASCADE DEFERRABLE INITIALLY DEFERRED, -- null for local source
+    track INTEGER NOT NULL REFERENCES track(id) ON DELETE CASCADE ON UPDATE CASCADE DEFERRABLE INITIALLY DEFERRED,
+    plays INTEGER NOT NULL,
+    secs_played INTEGER NOT NULL,
+    first_played INTEGER NOT NULL,
+    last_played INTEGER NOT NULL
+);
+
+CREATE INDEX playback_stats_source_track ON playback_stats(source, track);
+CREATE INDEX playback_stats_track ON playback_stats(track);
+
+INSERT INTO playback_stats(source, track, plays, secs_played, first_played, last_played)
+    SELECT source, track, count(*), sum(secs_played), min(playtime), max(playtime)
+    FROM playback_log
+    GROUP BY source, track;
+
+UPDATE settings SET v = '29' WHERE k == 'schema_version';
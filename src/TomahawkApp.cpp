@@ -395,6 +395,7 @@ TomahawkApp::printHelp()
     echo( "  --testdb       Use a test database instead of real collection\n" );
     echo( "  --noupnp       Disable UPnP\n" );
     echo( "  --nosip        Disable SIP\n" );
+    echo( "  --trigramindex Search with the trigram index instead of Lucene\n" );
     echo( "\nPlayback Controls:\n" );
     echo( "  --playpause    Toggle playing/paused state\n" );
     echo( "  --play         Start/resume playback\n" );
@@ -512,7 +513,7 @@ TomahawkApp::initDatabase()
     }
 
     tDebug( LOGEXTRA ) << "Using database:" << dbpath;
-    m_database = QWeakPointer<Database>( new Database( dbpath, this ) );
+    m_database = QWeakPointer<Database>( new Database( dbpath, arguments().contains( "--trigramindex" ), this ) );
     Pipeline::instance()->databaseReady();
 }
 
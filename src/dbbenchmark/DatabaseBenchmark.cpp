@@ -0,0 +1,801 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2026, agent <agent@local>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DatabaseBenchmark.h"
+
+#include <QDateTime>
+#include <QEventLoop>
+#include <QFile>
+#include <QSet>
+#include <QTextStream>
+#include <QTime>
+#include <QVector>
+#include <QtAlgorithms>
+
+#include "Pipeline.h"
+#include "Query.h"
+#include "Source.h"
+#include "SourceList.h"
+#include "database/Database.h"
+#include "database/DatabaseImpl.h"
+#include "database/LocalCollection.h"
+#include "database/TomahawkSqlQuery.h"
+#include "database/DatabaseCommand_AddFiles.h"
+#include "database/DatabaseCommand_AllAlbums.h"
+#include "database/DatabaseCommand_AllArtists.h"
+#include "database/DatabaseCommand_AllTracks.h"
+#include "database/DatabaseCommand_DeleteFiles.h"
+#include "database/DatabaseCommand_LoadOps.h"
+#include "database/DatabaseCommand_LoadPlaylistEntries.h"
+#include "database/DatabaseCommand_PlaybackHistory.h"
+#include "database/DatabaseCommand_Resolve.h"
+#include "database/DatabaseCommand_UpdateSearchIndex.h"
+#include "utils/EditDistance.h"
+#include "utils/Logger.h"
+
+using namespace Tomahawk;
+
+// the synthetic collection belongs to this remote source
+#define BENCHMARK_SOURCE_ID 1
+#define FILES_PER_ARTIST 100
+#define FILES_PER_ALBUM 10
+#define FILES_PER_PLAYLIST 1000
+#define PLAYLIST_SIZE 100
+#define PLAYS_PER_FILE 0.5
+#define OPS_PER_FILE 0.1
+#define RESOLVE_BATCH 100
+#define ALLTRACKS_BATCH 500
+// share of the files deleted at the end
+#define DELETED_FILES 0.1
+// pairs of names compared per run of the edit distance benchmark
+#define EDIT_DISTANCE_PAIRS 200000
+// the bound Query::howSimilar() typically ends up with
+#define EDIT_DISTANCE_BOUND 3
+// untimed pairs checked on top, for the code paths the short Latin-1 names above don't reach
+#define EDIT_DISTANCE_CHECKS 4000
+
+
+static QString
+artistName( int file )
+{
+    return QString( "Artist %1" ).arg( file / FILES_PER_ARTIST );
+}
+
+
+static QString
+albumName( int file )
+{
+    return QString( "Album %1" ).arg( file / FILES_PER_ALBUM );
+}
+
+
+static QString
+trackName( int file )
+{
+    return QString( "Track %1" ).arg( file );
+}
+
+
+static QChar
+randomChar( const QString& alphabet )
+{
+    return alphabet.at( qrand() % alphabet.length() );
+}
+
+
+// a small alphabet, so that pairs have something in common
+static QString
+randomName( int minLength = 5, int maxLength = 30, const QString& alphabet = QString( "abcdefgh " ) )
+{
+    QString name;
+    const int length = minLength + qrand() % ( maxLength - minLength + 1 );
+    for ( int i = 0; i < length; i++ )
+        name += randomChar( alphabet );
+
+    return name;
+}
+
+
+// Latin-1 and beyond, editDistance() keeps separate masks for the characters past Latin-1
+static QString
+nonLatin1Alphabet()
+{
+    QString alphabet( "ab " );
+    alphabet += QChar( 0x00e9 ); // e acute
+    alphabet += QChar( 0x0416 ); // Cyrillic zhe
+    alphabet += QChar( 0x3042 ); // Hiragana a
+    alphabet += QChar( 0x3044 ); // Hiragana i
+    alphabet += QChar( 0x4e2d ); // CJK "middle"
+    return alphabet;
+}
+
+
+// a copy of name with a few random edits, like a slightly different tag of the same track
+static QString
+misspelled( const QString& name, const QString& replacements = QString( "xy" ) )
+{
+    QString result = name;
+    const int edits = qrand() % 4;
+    for ( int i = 0; i < edits && result.length() > 1; i++ )
+    {
+        const int pos = qrand() % ( result.length() - 1 );
+        switch ( qrand() % 4 )
+        {
+            case 0:
+                result.remove( pos, 1 );
+                break;
+            case 1:
+                result.insert( pos, randomChar( replacements ) );
+                break;
+            case 2:
+                result[ pos ] = randomChar( replacements );
+                break;
+            default:
+            {
+                const QChar c = result.at( pos );
+                result[ pos ] = result.at( pos + 1 );
+                result[ pos + 1 ] = c;
+            }
+        }
+    }
+
+    return result;
+}
+
+
+// the full matrix implementation Query::levenshtein() used before TomahawkUtils::editDistance()
+static int
+referenceDistance( const QString& source, const QString& target )
+{
+    const int n = source.length();
+    const int m = target.length();
+
+    if ( n == 0 )
+        return m;
+    if ( m == 0 )
+        return n;
+
+    QVector< QVector< int > > matrix( n + 1, QVector< int >( m + 1 ) );
+    for ( int i = 0; i <= n; i++ )
+        matrix[ i ][ 0 ] = i;
+    for ( int j = 0; j <= m; j++ )
+        matrix[ 0 ][ j ] = j;
+
+    for ( int i = 1; i <= n; i++ )
+    {
+        const QChar s_i = source[ i - 1 ];
+        for ( int j = 1; j <= m; j++ )
+        {
+            const QChar t_j = target[ j - 1 ];
+            const int cost = ( s_i == t_j ) ? 0 : 1;
+
+            int cell = qMin( matrix[ i ][ j - 1 ] + 1, matrix[ i - 1 ][ j - 1 ] + cost );
+            cell = qMin( cell, matrix[ i - 1 ][ j ] + 1 );
+
+            if ( i > 2 && j > 2 )
+            {
+                int trans = matrix[ i - 2 ][ j - 2 ] + 1;
+                if ( source[ i - 2 ] != t_j )
+                    trans++;
+                if ( s_i != target[ j - 2 ] )
+                    trans++;
+                cell = qMin( cell, trans );
+            }
+
+            matrix[ i ][ j ] = cell;
+        }
+    }
+
+    return matrix[ n ][ m ];
+}
+
+
+// "SCAN TABLE file" or "SCAN file" with newer sqlite versions, but no scans of an index
+static bool
+isFullScan( const QString& detail )
+{
+    return detail.startsWith( "SCAN " ) &&
+           !detail.contains( "INDEX" ) &&
+           !detail.contains( "SUBQUERY" ) &&
+           !detail.contains( "CONSTANT ROW" );
+}
+
+
+static void
+waitFor( QObject* sender, const char* signal )
+{
+    // queued, the signal might get emitted before we enter the loop
+    QEventLoop loop;
+    QObject::connect( sender, signal, &loop, SLOT( quit() ), Qt::QueuedConnection );
+    loop.exec();
+}
+
+
+class CreateSourceCommand : public DatabaseCommand
+{
+public:
+    virtual QString commandname() const { return "benchmarkcreatesource"; }
+
+    virtual void exec( DatabaseImpl* dbi )
+    {
+        TomahawkSqlQuery query = dbi->newquery();
+        query.prepare( "INSERT INTO source(id, name, friendlyname, isonline) VALUES(?, ?, ?, 'false')" );
+        query.addBindValue( BENCHMARK_SOURCE_ID );
+        query.addBindValue( "benchmark" );
+        query.addBindValue( "Benchmark" );
+        if ( !query.exec() )
+            throw "Failed to create benchmark source";
+    }
+};
+
+
+// fills the tables the benchmarked commands read from, apart from the collection itself
+class PopulateCommand : public DatabaseCommand
+{
+public:
+    explicit PopulateCommand( int files )
+        : DatabaseCommand()
+        , m_files( files )
+    {}
+
+    virtual QString commandname() const { return "benchmarkpopulate"; }
+
+    virtual void exec( DatabaseImpl* dbi )
+    {
+        qsrand( m_files );
+        const uint now = QDateTime::currentDateTime().toTime_t();
+
+        QList< int > trackIds;
+        TomahawkSqlQuery query = dbi->newquery();
+        query.exec( "SELECT id FROM track" );
+        while ( query.next() )
+            trackIds << query.value( 0 ).toInt();
+
+        if ( trackIds.isEmpty() )
+            throw "No tracks to populate the database with";
+
+        QVariantList playlistValues, revisionValues, itemValues;
+        for ( int i = 0; i < qMax( 1, m_files / FILES_PER_PLAYLIST ); i++ )
+        {
+            const QString playlistGuid = uuid();
+            revisionGuid = uuid();
+
+            QStringList entries;
+            for ( int j = 0; j < PLAYLIST_SIZE; j++ )
+            {
+                const QString itemGuid = uuid();
+                const int file = qrand() % m_files;
+                entries << QString( "\"%1\"" ).arg( itemGuid );
+
+                itemValues << itemGuid << playlistGuid << trackName( file ) << artistName( file ) << albumName( file )
+                           << 180 << now << BENCHMARK_SOURCE_ID;
+            }
+
+            playlistValues << playlistGuid << BENCHMARK_SOURCE_ID << QString( "Playlist %1" ).arg( i ) << revisionGuid << now << now;
+            revisionValues << revisionGuid << playlistGuid << QString( "[%1]" ).arg( entries.join( "," ) ) << BENCHMARK_SOURCE_ID << now;
+        }
+
+        QVariantList playValues;
+        for ( int i = 0; i < m_files * PLAYS_PER_FILE; i++ )
+        {
+            // spread over the last year
+            playValues << BENCHMARK_SOURCE_ID << trackIds.at( qrand() % trackIds.count() )
+                       << now - qrand() % ( 365 * 24 * 3600 ) << 180;
+        }
+
+        // the oplog of the local source, which peers load their updates from
+        QVariantList opValues;
+        const int ops = qMax( 1, (int)( m_files * OPS_PER_FILE ) );
+        for ( int i = 0; i < ops; i++ )
+        {
+            const QString guid = uuid();
+            if ( i == ops / 2 )
+                sinceGuid = guid;
+
+            opValues << QVariant( QVariant::Int ) << guid << "addfiles" << false << false << "{}";
+        }
+
+        if ( !dbi->insertRows( "INSERT INTO playlist(guid, source, title, currentrevision, lastmodified, createdOn)", 6, playlistValues ) ||
+             !dbi->insertRows( "INSERT INTO playlist_revision(guid, playlist, entries, author, timestamp)", 5, revisionValues ) ||
+             !dbi->insertRows( "INSERT INTO playlist_item(guid, playlist, trackname, artistname, albumname, duration, addedon, addedby)", 8, itemValues ) ||
+             !dbi->insertRows( "INSERT INTO playback_log(source, track, playtime, secs_played)", 4, playValues ) ||
+             !dbi->insertRows( "INSERT INTO oplog(source, guid, command, singleton, compressed, json)", 6, opValues ) )
+        {
+            throw "Failed to populate the database";
+        }
+    }
+
+    QString revisionGuid;
+    QString sinceGuid;
+
+private:
+    int m_files;
+};
+
+
+class ExplainCommand : public DatabaseCommand
+{
+public:
+    explicit ExplainCommand( const QStringList& statements )
+        : DatabaseCommand()
+        , m_statements( statements )
+    {}
+
+    virtual QString commandname() const { return "benchmarkexplain"; }
+    virtual bool doesMutates() const { return false; }
+
+    virtual void exec( DatabaseImpl* dbi )
+    {
+        foreach ( const QString& statement, m_statements )
+        {
+            // parameters that aren't bound are NULL, that doesn't change the plan
+            TomahawkSqlQuery query = dbi->newquery();
+            query.exec( "EXPLAIN QUERY PLAN " + statement );
+            while ( query.next() )
+                plans[ statement ] << query.value( 3 ).toString();
+        }
+    }
+
+    QMap< QString, QStringList > plans;
+
+private:
+    QStringList m_statements;
+};
+
+
+DatabaseBenchmark::DatabaseBenchmark( const QString& dbPath, int files, int runs )
+    : QObject()
+    , m_dbPath( dbPath )
+    , m_files( qMax( 1, files ) )
+    , m_runs( qMax( 1, runs ) )
+    , m_trigramIndex( false )
+    , m_distanceMismatches( 0 )
+{
+}
+
+
+DatabaseBenchmark::~DatabaseBenchmark()
+{
+    delete Database::instance();
+    delete Pipeline::instance();
+}
+
+
+int
+DatabaseBenchmark::run()
+{
+    if ( !setUp() )
+        return 2;
+
+    populate();
+    measureEditDistance();
+    report();
+
+    const int result = compareWithBaseline();
+    if ( m_distanceMismatches )
+    {
+        QTextStream out( stdout );
+        out << m_distanceMismatches << " edit distances differ from the reference implementation" << endl;
+        return 1;
+    }
+
+    return result;
+}
+
+
+bool
+DatabaseBenchmark::setUp()
+{
+    if ( QFile::exists( m_dbPath ) && !QFile::remove( m_dbPath ) )
+    {
+        tLog() << "Can't remove old benchmark database:" << m_dbPath;
+        return false;
+    }
+
+    new Pipeline();
+
+    Database* db = new Database( m_dbPath, m_trigramIndex );
+    db->loadIndex();
+    waitFor( db, SIGNAL( ready() ) );
+    Pipeline::instance()->start();
+
+    source_ptr local( new Source( 0, "Benchmark" ) );
+    local->addCollection( collection_ptr( new LocalCollection( local ) ) );
+    SourceList::instance()->setLocal( local );
+
+    exec( new CreateSourceCommand() );
+
+    SourceList::instance()->loadSources();
+    waitFor( SourceList::instance(), SIGNAL( ready() ) );
+
+    m_source = SourceList::instance()->get( BENCHMARK_SOURCE_ID );
+    return !m_source.isNull();
+}
+
+
+void
+DatabaseBenchmark::populate()
+{
+    QVariantList files;
+    for ( int i = 0; i < m_files; i++ )
+    {
+        QVariantMap m;
+        // remote sources send their file ids as urls
+        m[ "url" ] = QString::number( i + 1 );
+        m[ "mtime" ] = i;
+        m[ "size" ] = 5 * 1024 * 1024;
+        m[ "hash" ] = QString();
+        m[ "mimetype" ] = "audio/mpeg";
+        m[ "duration" ] = 120 + i % 240;
+        m[ "bitrate" ] = 192;
+        m[ "artist" ] = artistName( i );
+        m[ "album" ] = albumName( i );
+        m[ "track" ] = trackName( i );
+        m[ "albumpos" ] = i % FILES_PER_ALBUM + 1;
+        m[ "composer" ] = QString();
+        m[ "discnumber" ] = 1;
+        m[ "year" ] = 1970 + ( i / FILES_PER_ARTIST ) % 40;
+
+        files << m;
+    }
+
+    QList< DatabaseCommand* > cmds;
+    cmds << new DatabaseCommand_AddFiles( files, m_source );
+    measure( QString( "AddFiles (%1 files)" ).arg( m_files ), cmds );
+
+    cmds.clear();
+    cmds << new DatabaseCommand_UpdateSearchIndex();
+    measure( "UpdateSearchIndex", cmds );
+
+    PopulateCommand* populate = new PopulateCommand( m_files );
+    QSharedPointer<DatabaseCommand> populateptr( populate ); // keep it around for the guids
+    exec( populate );
+
+    qsrand( m_files );
+    cmds.clear();
+    for ( int i = 0; i < m_runs; i++ )
+    {
+        const int file = qrand() % m_files;
+        cmds << new DatabaseCommand_Resolve( Query::get( artistName( file ), trackName( file ), albumName( file ), QString(), false ) );
+    }
+    measure( "Resolve", cmds );
+
+    cmds.clear();
+    for ( int i = 0; i < m_runs; i++ )
+    {
+        const int file = qrand() % m_files;
+        cmds << new DatabaseCommand_Resolve( Query::get( artistName( file ) + " " + trackName( file ), QString() ) );
+    }
+    measure( "Resolve (full text)", cmds );
+
+    // mostly spends its time in the search index, compare with and without --trigramindex
+    cmds.clear();
+    for ( int i = 0; i < m_runs; i++ )
+    {
+        QList< query_ptr > queries;
+        for ( int j = 0; j < RESOLVE_BATCH; j++ )
+        {
+            const int file = qrand() % m_files;
+            queries << Query::get( artistName( file ), trackName( file ), QString(), uuid(), false );
+        }
+        cmds << new DatabaseCommand_Resolve( queries );
+    }
+    measure( QString( "Resolve (%1 queries)" ).arg( RESOLVE_BATCH ), cmds );
+
+    cmds.clear();
+    for ( int i = 0; i < m_runs; i++ )
+        cmds << new DatabaseCommand_AllTracks( m_source->collection() );
+    measure( "AllTracks", cmds );
+
+    // what CollectionFlatModel runs, in an order the keyset paging serves from an index and in one it doesn't
+    cmds.clear();
+    for ( int i = 0; i < m_runs; i++ )
+    {
+        DatabaseCommand_AllTracks* cmd = new DatabaseCommand_AllTracks( m_source->collection() );
+        cmd->setBatchSize( ALLTRACKS_BATCH );
+        cmd->setSortOrder( DatabaseCommand_AllTracks::ModificationTime );
+        cmds << cmd;
+    }
+    measure( "AllTracks, paged by mtime", cmds );
+
+    cmds.clear();
+    for ( int i = 0; i < m_runs; i++ )
+    {
+        DatabaseCommand_AllTracks* cmd = new DatabaseCommand_AllTracks( m_source->collection() );
+        cmd->setBatchSize( ALLTRACKS_BATCH );
+        cmd->setSortOrder( DatabaseCommand_AllTracks::Album );
+        cmds << cmd;
+    }
+    measure( "AllTracks, paged by album", cmds );
+
+    cmds.clear();
+    for ( int i = 0; i < m_runs; i++ )
+        cmds << new DatabaseCommand_AllArtists( m_source->collection() );
+    measure( "AllArtists", cmds );
+
+    cmds.clear();
+    for ( int i = 0; i < m_runs; i++ )
+        cmds << new DatabaseCommand_AllAlbums( m_source->collection() );
+    measure( "AllAlbums", cmds );
+
+    cmds.clear();
+    for ( int i = 0; i < m_runs; i++ )
+        cmds << new DatabaseCommand_LoadPlaylistEntries( populate->revisionGuid );
+    measure( "LoadPlaylistEntries", cmds );
+
+    cmds.clear();
+    for ( int i = 0; i < m_runs; i++ )
+        cmds << new DatabaseCommand_loadOps( SourceList::instance()->getLocal(), populate->sinceGuid );
+    measure( "LoadOps", cmds );
+
+    cmds.clear();
+    for ( int i = 0; i < m_runs; i++ )
+        cmds << new DatabaseCommand_PlaybackHistory( m_source );
+    measure( "PlaybackHistory", cmds );
+
+    // deleting changes the collection, so this one only runs once
+    QVariantList ids;
+    for ( int i = 0; i < m_files * DELETED_FILES; i++ )
+        ids << QString::number( qrand() % m_files + 1 );
+
+    cmds.clear();
+    cmds << new DatabaseCommand_DeleteFiles( ids, m_source );
+    measure( QString( "DeleteFiles (%1 files)" ).arg( ids.count() ), cmds );
+}
+
+
+void
+DatabaseBenchmark::measureEditDistance()
+{
+    qsrand( EDIT_DISTANCE_PAIRS );
+    QStringList sources, targets;
+    for ( int i = 0; i < EDIT_DISTANCE_PAIRS; i++ )
+    {
+        const QString name = randomName();
+        sources << name;
+        // half of the pairs are close, like the candidates a resolver returns
+        targets << ( i % 2 ? misspelled( name ) : randomName() );
+    }
+
+    const QString pairs = QString( "%1 pairs" ).arg( EDIT_DISTANCE_PAIRS );
+    Measurement reference, unbounded, bounded;
+    reference.command = QString( "Edit distance, reference (%1)" ).arg( pairs );
+    unbounded.command = QString( "Edit distance (%1)" ).arg( pairs );
+    bounded.command = QString( "Edit distance, bound %1 (%2)" ).arg( EDIT_DISTANCE_BOUND ).arg( pairs );
+
+    QVector< int > expected( EDIT_DISTANCE_PAIRS );
+    for ( int run = 0; run < m_runs; run++ )
+    {
+        QTime timer;
+        timer.start();
+        for ( int i = 0; i < EDIT_DISTANCE_PAIRS; i++ )
+            expected[ i ] = referenceDistance( sources.at( i ), targets.at( i ) );
+        reference.times << timer.elapsed();
+
+        // checked after the timing, so that only the distance gets measured
+        QVector< int > distances( EDIT_DISTANCE_PAIRS );
+        timer.start();
+        for ( int i = 0; i < EDIT_DISTANCE_PAIRS; i++ )
+            distances[ i ] = TomahawkUtils::editDistance( sources.at( i ), targets.at( i ) );
+        unbounded.times << timer.elapsed();
+
+        QVector< int > boundedDistances( EDIT_DISTANCE_PAIRS );
+        timer.start();
+        for ( int i = 0; i < EDIT_DISTANCE_PAIRS; i++ )
+            boundedDistances[ i ] = TomahawkUtils::editDistance( sources.at( i ), targets.at( i ), EDIT_DISTANCE_BOUND );
+        bounded.times << timer.elapsed();
+
+        if ( run > 0 )
+            continue;
+
+        for ( int i = 0; i < EDIT_DISTANCE_PAIRS; i++ )
+            checkEditDistance( sources.at( i ), targets.at( i ), expected.at( i ), distances.at( i ), boundedDistances.at( i ) );
+    }
+
+    // Names longer than 64 characters, where editDistance() falls back to the matrix once both
+    // are that long, and names with characters past Latin-1. Only checked, not timed.
+    const QString otherAlphabet = nonLatin1Alphabet();
+    for ( int i = 0; i < EDIT_DISTANCE_CHECKS; i++ )
+    {
+        const bool close = ( i / 4 ) % 2;
+        QString source, target;
+        switch ( i % 4 )
+        {
+            case 0: // both too long for a bit vector
+                source = randomName( 65, 120 );
+                target = close ? misspelled( source ) : randomName( 65, 120 );
+                break;
+            case 1: // only one of them
+                source = randomName( 65, 120 );
+                target = close ? misspelled( source.left( 30 + qrand() % 35 ) ) : randomName( 5, 64 );
+                break;
+            case 2:
+                source = randomName( 5, 30, otherAlphabet );
+                target = close ? misspelled( source, otherAlphabet ) : randomName( 5, 30, otherAlphabet );
+                break;
+            default: // a long one against a short one, past Latin-1
+                source = randomName( 65, 120, otherAlphabet );
+                target = close ? misspelled( source.left( 30 + qrand() % 35 ), otherAlphabet ) : randomName( 5, 64, otherAlphabet );
+        }
+
+        checkEditDistance( source, target, referenceDistance( source, target ),
+                           TomahawkUtils::editDistance( source, target ),
+                           TomahawkUtils::editDistance( source, target, EDIT_DISTANCE_BOUND ) );
+    }
+
+    qSort( reference.times );
+    qSort( unbounded.times );
+    qSort( bounded.times );
+    m_measurements << reference << unbounded << bounded;
+}
+
+
+void
+DatabaseBenchmark::checkEditDistance( const QString& source, const QString& target, int expected, int distance, int boundedDistance )
+{
+    // past the bound, all we get is some distance that's past it too
+    const bool boundedOk = expected > EDIT_DISTANCE_BOUND ? boundedDistance > EDIT_DISTANCE_BOUND
+                                                          : boundedDistance == expected;
+    if ( distance == expected && boundedOk )
+        return;
+
+    tDebug() << "Edit distance mismatch:" << source << target << "expected" << expected << "got" << distance << boundedDistance;
+    m_distanceMismatches++;
+}
+
+
+int
+DatabaseBenchmark::exec( DatabaseCommand* cmd )
+{
+    QSharedPointer<DatabaseCommand> cmdptr( cmd );
+
+    QEventLoop loop;
+    connect( cmd, SIGNAL( finished() ), &loop, SLOT( quit() ), Qt::QueuedConnection );
+
+    QTime timer;
+    timer.start();
+    Database::instance()->enqueue( cmdptr );
+    loop.exec();
+
+    return timer.elapsed();
+}
+
+
+void
+DatabaseBenchmark::measure( const QString& name, const QList< DatabaseCommand* >& cmds )
+{
+    Measurement m;
+    m.command = name;
+
+    for ( int i = 0; i < cmds.count(); i++ )
+    {
+        TomahawkSqlQuery::setRecording( i == 0 );
+        m.times << exec( cmds.at( i ) );
+
+        if ( i == 0 )
+        {
+            TomahawkSqlQuery::setRecording( false );
+            m.fullScans = fullScans( TomahawkSqlQuery::takeRecordedStatements() );
+        }
+    }
+
+    qSort( m.times );
+    tLog() << "Benchmarked" << name << "- median:" << m.times.at( m.times.count() / 2 ) << "ms";
+
+    m_measurements << m;
+}
+
+
+QStringList
+DatabaseBenchmark::fullScans( const QStringList& statements )
+{
+    ExplainCommand* cmd = new ExplainCommand( statements );
+    QSharedPointer<DatabaseCommand> cmdptr( cmd );
+    exec( cmd );
+
+    QStringList scans;
+    foreach ( const QString& statement, statements )
+    {
+        foreach ( const QString& detail, cmd->plans.value( statement ) )
+        {
+            if ( isFullScan( detail ) && !scans.contains( detail ) )
+            {
+                tDebug() << "Full table scan:" << detail << "in" << statement;
+                scans << detail;
+            }
+        }
+    }
+
+    return scans;
+}
+
+
+void
+DatabaseBenchmark::report()
+{
+    QTextStream out( stdout );
+    const QString index = m_trigramIndex ? "trigram" : "Lucene";
+    out << endl << "Database benchmark with " << m_files << " files, " << m_runs << " runs per command, "
+        << index << " search index" << endl << endl;
+    out << qSetFieldWidth( 32 ) << left << "command"
+        << qSetFieldWidth( 10 ) << right << "min ms" << "median ms" << "max ms"
+        << qSetFieldWidth( 0 ) << "  full table scans" << endl;
+
+    foreach ( const Measurement& m, m_measurements )
+    {
+        out << qSetFieldWidth( 32 ) << left << m.command
+            << qSetFieldWidth( 10 ) << right << m.times.first() << m.times.at( m.times.count() / 2 ) << m.times.last()
+            << qSetFieldWidth( 0 ) << "  " << m.fullScans.join( ", " ) << endl;
+    }
+
+    if ( m_planFile.isEmpty() )
+        return;
+
+    QFile file( m_planFile );
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Text ) )
+    {
+        tLog() << "Can't write query plans to" << m_planFile;
+        return;
+    }
+
+    QTextStream planOut( &file );
+    foreach ( const Measurement& m, m_measurements )
+    {
+        // the file counts differ between runs
+        const QString command = m.command.section( " (", 0, 0 );
+        foreach ( const QString& scan, m.fullScans )
+            planOut << command << "\t" << scan << endl;
+    }
+}
+
+
+int
+DatabaseBenchmark::compareWithBaseline()
+{
+    if ( m_baselineFile.isEmpty() )
+        return 0;
+
+    QFile file( m_baselineFile );
+    if ( !file.open( QIODevice::ReadOnly | QIODevice::Text ) )
+    {
+        tLog() << "Can't read baseline" << m_baselineFile;
+        return 2;
+    }
+
+    QSet< QString > expected;
+    QTextStream in( &file );
+    while ( !in.atEnd() )
+        expected << in.readLine().trimmed();
+
+    QTextStream out( stdout );
+    int regressions = 0;
+    foreach ( const Measurement& m, m_measurements )
+    {
+        const QString command = m.command.section( " (", 0, 0 );
+        foreach ( const QString& scan, m.fullScans )
+        {
+            if ( expected.contains( command + "\t" + scan ) )
+                continue;
+
+            out << "New full table scan in " << command << ": " << scan << endl;
+            regressions++;
+        }
+    }
+
+    return regressions ? 1 : 0;
+}
@@ -0,0 +1,94 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2026, agent <agent@local>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DATABASEBENCHMARK_H
+#define DATABASEBENCHMARK_H
+
+#include <QObject>
+#include <QList>
+#include <QMap>
+#include <QStringList>
+
+#include "Typedefs.h"
+
+class DatabaseCommand;
+
+/*
+    Fills a new database with a synthetic collection of the given size, then
+    times the database commands against it, as well as the edit distance
+    used to score resolver results.
+
+    The query plan of every statement a command runs gets checked for full
+    table scans. When given a baseline of the scans that are expected, any
+    other scan makes the benchmark fail.
+*/
+class DatabaseBenchmark : public QObject
+{
+Q_OBJECT
+
+public:
+    DatabaseBenchmark( const QString& dbPath, int files, int runs );
+    ~DatabaseBenchmark();
+
+    // the full table scans found get written here, one "command<TAB>plan detail" per line
+    void setPlanFile( const QString& path ) { m_planFile = path; }
+    // full table scans that are expected, in the same format
+    void setBaselineFile( const QString& path ) { m_baselineFile = path; }
+    // search with the trigram index instead of Lucene
+    void setTrigramIndex( bool enabled ) { m_trigramIndex = enabled; }
+
+    // returns non-zero if a command does a full table scan that isn't in the baseline
+    int run();
+
+private:
+    struct Measurement
+    {
+        QString command;
+        QList< int > times; // in ms
+        QStringList fullScans;
+    };
+
+    bool setUp();
+    void populate();
+    // checks TomahawkUtils::editDistance() against the plain matrix implementation it replaced and times both
+    void measureEditDistance();
+    // counts a mismatch if the distances differ from the expected one
+    void checkEditDistance( const QString& source, const QString& target, int expected, int distance, int boundedDistance );
+
+    // runs cmd on the database threads and waits for it to finish, returns how long it took in ms
+    int exec( DatabaseCommand* cmd );
+    // runs all commands, one after another, and checks the query plans of the statements run by the first one
+    void measure( const QString& name, const QList< DatabaseCommand* >& cmds );
+    QStringList fullScans( const QStringList& statements );
+
+    void report();
+    int compareWithBaseline();
+
+    QString m_dbPath;
+    int m_files;
+    int m_runs;
+    QString m_planFile;
+    QString m_baselineFile;
+    bool m_trigramIndex;
+    int m_distanceMismatches;
+
+    Tomahawk::source_ptr m_source;
+    QList< Measurement > m_measurements;
+};
+
+#endif // DATABASEBENCHMARK_H
@@ -0,0 +1,98 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2026, agent <agent@local>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DatabaseBenchmark.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QStringList>
+
+#include <iostream>
+
+const char* k_usage =
+    "Usage:\n"
+    "  tomahawk_dbbenchmark [--files <n>] [--runs <n>] [--db <path>] [--plans <file>] [--baseline <file>] [--trigramindex]\n"
+    "\n"
+    "  --files     size of the synthetic collection (default: 10000)\n"
+    "  --runs      how often every read-only command gets run (default: 5)\n"
+    "  --db        database file to create, gets overwritten (default: in the temp dir)\n"
+    "  --plans     write the full table scans found to this file\n"
+    "  --baseline  fail if a full table scan is found that isn't listed in this file\n"
+    "  --trigramindex  search with the trigram index instead of Lucene\n";
+
+int main( int argc, char* argv[] )
+{
+    // the search index lives in the app data dir, don't touch the one of the real app
+    QCoreApplication::setApplicationName( "Tomahawk" );
+    QCoreApplication::setOrganizationName( "TomahawkDbBenchmark" );
+    QCoreApplication::setOrganizationDomain( "tomahawk-player.org" );
+
+    QCoreApplication app( argc, argv );
+
+    int files = 10000;
+    int runs = 5;
+    QString dbPath = QDir::temp().filePath( "tomahawk_dbbenchmark.db" );
+    QString planFile, baselineFile;
+    bool trigramIndex = false;
+
+    const QStringList args = app.arguments();
+    for ( int i = 1; i < args.count(); i++ )
+    {
+        const QString arg = args.at( i );
+
+        if ( arg == "--trigramindex" )
+        {
+            trigramIndex = true;
+            continue;
+        }
+
+        if ( i + 1 >= args.count() )
+        {
+            std::cout << k_usage;
+            return 2;
+        }
+
+        const QString value = args.at( ++i );
+        bool ok = true;
+        if ( arg == "--files" )
+            files = value.toInt( &ok );
+        else if ( arg == "--runs" )
+            runs = value.toInt( &ok );
+        else if ( arg == "--db" )
+            dbPath = value;
+        else if ( arg == "--plans" )
+            planFile = value;
+        else if ( arg == "--baseline" )
+            baselineFile = value;
+        else
+            ok = false;
+
+        if ( !ok )
+        {
+            std::cout << k_usage;
+            return 2;
+        }
+    }
+
+    DatabaseBenchmark benchmark( dbPath, files, runs );
+    benchmark.setPlanFile( planFile );
+    benchmark.setBaselineFile( baselineFile );
+    benchmark.setTrigramIndex( trigramIndex );
+
+    return benchmark.run();
+}
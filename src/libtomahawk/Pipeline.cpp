@@ -18,22 +18,35 @@
 
 #include "Pipeline.h"
 
+#include <QDateTime>
+#include <QFile>
 #include <QMutexLocker>
 
+#include "Album.h"
+#include "Artist.h"
 #include "FuncTimeout.h"
 #include "database/Database.h"
 #include "ExternalResolver.h"
 #include "resolvers/ScriptResolver.h"
 #include "resolvers/QtScriptResolver.h"
 #include "Source.h"
+#include "SourceList.h"
+#include "TomahawkSettings.h"
 
 #include "utils/Logger.h"
+#include "utils/TomahawkUtils.h"
+
+#include <qjson/serializer.h>
 
 #include "boost/bind.hpp"
 
 #define DEFAULT_CONCURRENT_QUERIES 4
 #define MAX_CONCURRENT_QUERIES 16
+#define MAX_BATCH_SIZE 50
 #define CLEANUP_TIMEOUT 5 * 60 * 1000
+#define NEGATIVE_CACHE_SIZE 5000
+#define NEGATIVE_CACHE_TTL 30 * 60 * 1000
+#define MAX_FINISHED_TRACES 500
 #define MINSCORE 0.5
 
 using namespace Tomahawk;
@@ -50,6 +63,10 @@ Pipeline::instance()
 
 Pipeline::Pipeline( QObject* parent )
     : QObject( parent )
+    , m_savedResolverCalls( 0 )
+    , m_negativeCache( NEGATIVE_CACHE_SIZE )
+    , m_negativeCacheHits( 0 )
+    , m_tracing( false )
     , m_running( false )
 {
     s_instance = this;
@@ -59,6 +76,17 @@ Pipeline::Pipeline( QObject* parent )
 
     m_temporaryQueryTimer.setInterval( CLEANUP_TIMEOUT );
     connect( &m_temporaryQueryTimer, SIGNAL( timeout() ), SLOT( onTemporaryQueryTimer() ) );
+
+    m_maxRegisteredResults = qMax( (uint)100, TomahawkSettings::instance()->resultRegistrySize() );
+    m_registeredResultTimeout = (qint64)qMax( (uint)1, TomahawkSettings::instance()->resultRegistryTimeout() ) * 60 * 1000;
+    m_resultCleanupTimer.setInterval( CLEANUP_TIMEOUT );
+    connect( &m_resultCleanupTimer, SIGNAL( timeout() ), SLOT( pruneResults() ) );
+    m_resultCleanupTimer.start();
+
+    setTracingEnabled( TomahawkSettings::instance()->pipelineTracing() );
+
+    // tracks we couldn't find before might be available in new or changed collections
+    connect( SourceList::instance(), SIGNAL( sourceAdded( Tomahawk::source_ptr ) ), SLOT( onSourceAdded( Tomahawk::source_ptr ) ) );
 }
 
 
@@ -67,6 +95,9 @@ Pipeline::~Pipeline()
     tDebug() << Q_FUNC_INFO;
     m_running = false;
 
+    if ( m_tracing )
+        dumpMetrics( TomahawkUtils::appLogDir().filePath( "PipelineMetrics.json" ) );
+
     // stop script resolvers
     foreach ( QWeakPointer< ExternalResolver > r, m_scriptResolvers )
         if ( !r.isNull() )
@@ -87,7 +118,7 @@ Pipeline::databaseReady()
 void
 Pipeline::start()
 {
-    tDebug() << Q_FUNC_INFO << "Shunting this many pending queries:" << m_queries_pending.size();
+    tDebug() << Q_FUNC_INFO << "Shunting this many pending queries:" << m_queries_pending.count();
     m_running = true;
 
     shuntNext();
@@ -104,9 +135,29 @@ Pipeline::stop()
 void
 Pipeline::removeResolver( Resolver* r )
 {
-    QMutexLocker lock( &m_mut );
+    QList< query_ptr > backlog;
+    {
+        QMutexLocker lock( &m_mut );
+
+        m_resolvers.removeAll( r );
+        m_resolverStats.remove( r );
+        foreach ( const query_ptr& q, m_resolverBacklog.take( r ) )
+        {
+            m_backlogged.remove( q->id() );
+            m_dispatchTimes.remove( qMakePair( q->id(), r ) );
+            if ( m_qidsState.contains( q->id() ) )
+            {
+                m_unanswered.insert( q->id() );
+                backlog << q;
+            }
+        }
+        updateResolverSetKey();
+    }
+
+    // the queries that were waiting for it move on to the next resolver
+    foreach ( const query_ptr& q, backlog )
+        decQIDState( q );
 
-    m_resolvers.removeAll( r );
     emit resolverRemoved( r );
 }
 
@@ -118,6 +169,10 @@ Pipeline::addResolver( Resolver* r )
 
     tDebug() << "Adding resolver" << r->name();
     m_resolvers.append( r );
+    updateResolverSetKey();
+
+    // the new resolver might find what all the others couldn't
+    m_negativeCache.clear();
     emit resolverAdded( r );
 }
 
@@ -197,27 +252,45 @@ Pipeline::resolverForPath( const QString& scriptPath )
 void
 Pipeline::resolve( const QList<query_ptr>& qlist, bool prioritized, bool temporaryQuery )
 {
+    resolve( qlist, prioritized ? ResolvePriority::Visible : ResolvePriority::Background, temporaryQuery );
+}
+
+
+void
+Pipeline::resolve( const QList<query_ptr>& qlist, ResolvePriority::Priority priority, bool temporaryQuery )
+{
+    QList< query_ptr > misses;
+    QList< QPair< query_ptr, QList< result_ptr > > > catchUp;
     {
         QMutexLocker lock( &m_mut );
 
-        int i = 0;
+        QList< query_ptr > queries;
         foreach( const query_ptr& q, qlist )
         {
             if ( q->resolvingFinished() )
                 continue;
             if ( m_queries_pending.contains( q ) )
+            {
+                m_queries_pending.promote( q, priority );
                 continue;
+            }
             if ( m_qidsState.contains( q->id() ) )
                 continue;
 
+            // don't bother the resolvers again with a track none of them found just recently
+            if ( isKnownMiss( q ) )
+            {
+                if ( m_tracing )
+                    m_traces.insert( q->id(), ResolveTrace( q->id(), q->toString(), QDateTime::currentMSecsSinceEpoch() ) );
+                finishTrace( q->id(), ResolveTrace::KnownMiss );
+
+                misses << q;
+                continue;
+            }
+
             if ( !m_qids.contains( q->id() ) )
                 m_qids.insert( q->id(), q );
 
-            if ( prioritized )
-                m_queries_pending.insert( i++, q );
-            else
-                m_queries_pending << q;
-
             if ( temporaryQuery )
             {
                 m_queries_temporary << q;
@@ -226,9 +299,52 @@ Pipeline::resolve( const QList<query_ptr>& qlist, bool prioritized, bool tempora
                     m_temporaryQueryTimer.stop();
                 m_temporaryQueryTimer.start();
             }
+
+            // is the very same track already being resolved? Then just wait for its results
+            const QString key = queryKey( q );
+            if ( !key.isEmpty() )
+            {
+                const query_ptr leader = m_queriesByKey.value( key );
+                if ( !leader.isNull() && leader != q )
+                {
+                    if ( !m_duplicateQueries.value( leader->id() ).contains( q ) )
+                    {
+                        tLog( LOGVERBOSE ) << "Coalescing" << q->toString() << "with in-flight" << leader->toString();
+                        m_duplicateQueries[ leader->id() ] << q;
+
+                        // only results reported from now on get forwarded, so catch up with the earlier ones
+                        const QList< result_ptr > results = leader->results();
+                        if ( !results.isEmpty() )
+                        {
+                            bindReresolvedResult( q, results.first() );
+                            catchUp << qMakePair( q, results );
+                        }
+                    }
+
+                    m_queries_pending.promote( leader, priority );
+                    continue;
+                }
+
+                m_queriesByKey.insert( key, q );
+            }
+
+            if ( m_tracing )
+                m_traces.insert( q->id(), ResolveTrace( q->id(), q->toString(), QDateTime::currentMSecsSinceEpoch() ) );
+
+            queries << q;
         }
+
+        m_queries_pending.enqueue( queries, priority );
+        m_negativeCacheHits += misses.count();
     }
 
+    foreach ( const query_ptr& q, misses )
+        q->onResolvingFinished();
+
+    typedef QPair< query_ptr, QList< result_ptr > > CatchUpPair;
+    foreach ( const CatchUpPair& pair, catchUp )
+        addMissingResults( pair.first, pair.second );
+
     shuntNext();
 }
 
@@ -253,11 +369,70 @@ Pipeline::resolve( QID qid, bool prioritized, bool temporaryQuery )
 
 
 void
-Pipeline::reportResults( QID qid, const QList< result_ptr >& results )
+Pipeline::resolve( const query_ptr& q, ResolvePriority::Priority priority, bool temporaryQuery )
+{
+    if ( q.isNull() )
+        return;
+
+    QList< query_ptr > qlist;
+    qlist << q;
+    resolve( qlist, priority, temporaryQuery );
+}
+
+
+void
+Pipeline::setPriority( const query_ptr& q, ResolvePriority::Priority priority )
+{
+    if ( q.isNull() )
+        return;
+
+    QMutexLocker lock( &m_mut );
+    m_queries_pending.setPriority( q, priority );
+}
+
+
+void
+Pipeline::promote( const query_ptr& q, ResolvePriority::Priority priority )
+{
+    if ( q.isNull() )
+        return;
+
+    QMutexLocker lock( &m_mut );
+    m_queries_pending.promote( q, priority );
+}
+
+
+void
+Pipeline::reportResults( QID qid, Tomahawk::Resolver* r, const QList< result_ptr >& results )
 {
     if ( !m_running )
         return;
 
+    // false for an answer arriving after timeoutShunt() already counted the resolver off.
+    // Its results are still welcome, but the query must not wait for one resolver less again
+    bool awaited = true;
+    if ( r )
+    {
+        QMutexLocker lock( &m_mut );
+
+        const QPair< QID, Resolver* > key = qMakePair( qid, r );
+        const qint64 dispatched = m_dispatchTimes.value( key );
+        awaited = ( dispatched > 0 );
+        if ( awaited )
+        {
+            m_dispatchTimes.remove( key );
+            if ( m_resolverStats.contains( r ) )
+            {
+                const int latency = QDateTime::currentMSecsSinceEpoch() - dispatched;
+                m_resolverStats[ r ].answered( latency, !results.isEmpty() );
+
+                // the resolver has a free slot again
+                if ( m_resolverBacklog.contains( r ) )
+                    new FuncTimeout( 0, boost::bind( &Pipeline::dispatchBacklog, this, r ), this );
+            }
+        }
+    }
+
     if ( !m_qids.contains( qid ) )
     {
         tDebug() << "Result arrived too late for:" << qid;
@@ -266,23 +441,47 @@ Pipeline::reportResults( QID qid, const QList< result_ptr >& results )
     const query_ptr& q = m_qids.value( qid );
 
     QList< result_ptr > cleanResults;
-    foreach( const result_ptr& r, results )
+    QList< float > scores;
+    foreach( const result_ptr& result, results )
     {
-        float score = q->howSimilar( r );
-        r->setScore( score );
+        float score = q->howSimilar( result, MINSCORE );
+        result->setScore( score );
+        scores << score;
         if ( !q->isFullTextQuery() && score < MINSCORE )
             continue;
 
-        cleanResults << r;
+        cleanResults << result;
+    }
+
+    if ( r )
+    {
+        QMutexLocker lock( &m_mut );
+
+        if ( m_resolverStats.contains( r ) )
+        {
+            foreach ( float score, scores )
+                m_resolverStats[ r ].scored( score );
+        }
+        if ( m_traces.contains( qid ) )
+            m_traces[ qid ].answered( r->name(), QDateTime::currentMSecsSinceEpoch(), scores );
     }
 
     if ( !cleanResults.isEmpty() )
     {
         q->addResults( cleanResults );
-        foreach( const result_ptr& r, cleanResults )
+
+        QList< query_ptr > duplicates;
         {
-            m_rids.insert( r->id(), r );
+            QMutexLocker lock( &m_mut );
+            registerResults( cleanResults );
+            bindReresolvedResult( q, q->results().first() );
+
+            duplicates = m_duplicateQueries.value( qid );
+            foreach ( const query_ptr& dq, duplicates )
+                bindReresolvedResult( dq, q->results().first() );
         }
+        foreach ( const query_ptr& dq, duplicates )
+            addMissingResults( dq, cleanResults );
 
         if ( q->solved() && !q->isFullTextQuery() )
         {
@@ -291,7 +490,8 @@ Pipeline::reportResults( QID qid, const QList< result_ptr >& results )
         }
     }
 
-    decQIDState( q );
+    if ( awaited )
+        decQIDState( q );
 }
 
 
@@ -360,7 +560,7 @@ Pipeline::shuntNext()
         return;
 
     unsigned int rc;
-    query_ptr q;
+    QList< query_ptr > qlist;
     {
         QMutexLocker lock( &m_mut );
 
@@ -372,68 +572,540 @@ Pipeline::shuntNext()
             return;
         }
 
-        // Check if we are ready to dispatch more queries
-        if ( m_qidsState.count() >= m_maxConcurrentQueries )
+        // Check if we are ready to dispatch more queries. The ones waiting for a
+        // throttled resolver don't count, so a slow resolver can't stall all others
+        const int active = m_qidsState.count() - m_backlogged.count();
+        if ( active >= m_maxConcurrentQueries )
             return;
 
         /*
             Since resolvers are async, we now dispatch to the highest weighted ones
-            and after timeout, dispatch to next highest etc, aborting when solved
+            and after timeout, dispatch to next highest etc, aborting when solved.
+
+            If more queries are pending than we have free slots, dispatch a whole
+            batch at once, so resolvers can answer them in a single go.
         */
-        q = m_queries_pending.takeFirst();
-        q->setCurrentResolver( 0 );
+        int batchSize = 1;
+        if ( m_queries_pending.count() > m_maxConcurrentQueries - active )
+            batchSize = MAX_BATCH_SIZE;
+
+        while ( qlist.count() < batchSize && !m_queries_pending.isEmpty() )
+        {
+            query_ptr q = m_queries_pending.take();
+            q->setCurrentResolver( 0 );
+
+            m_qidsState.insert( q->id(), rc );
+            qlist << q;
+        }
     }
 
-    setQIDState( q, rc );
+    new FuncTimeout( 0, boost::bind( &Pipeline::shunt, this, qlist ), this );
 }
 
 
 void
-Pipeline::timeoutShunt( const query_ptr& q )
+Pipeline::timeoutShunt( const query_ptr& q, Tomahawk::Resolver* r )
 {
     if ( !m_running )
         return;
 
-    // are we still waiting for a timeout?
-    if ( m_qidsTimeout.contains( q->id() ) )
     {
-        decQIDState( q );
+        QMutexLocker lock( &m_mut );
+
+        // are we still waiting for this resolver to answer?
+        const QPair< QID, Resolver* > key = qMakePair( q->id(), r );
+        if ( !m_dispatchTimes.contains( key ) )
+            return;
+
+        m_dispatchTimes.remove( key );
+        m_unanswered.insert( q->id() );
+        if ( m_resolverStats.contains( r ) )
+        {
+            m_resolverStats[ r ].timedOut();
+            if ( m_traces.contains( q->id() ) )
+                m_traces[ q->id() ].timedOut( r->name() );
+            tLog( LOGVERBOSE ) << "Resolver timed out:" << r->name() << q->toString()
+                               << "- lowering concurrency limit to" << m_resolverStats[ r ].concurrencyLimit();
+        }
     }
+
+    decQIDState( q );
+    dispatchBacklog( r );
 }
 
 
 void
-Pipeline::shunt( const query_ptr& q )
+Pipeline::shunt( const QList< query_ptr >& qlist )
 {
     if ( !m_running )
         return;
 
-    Resolver* r = 0;
-    if ( !q->resolvingFinished() )
-        r = nextResolver( q );
-
-    if ( r )
+    // group the queries by the resolver they have to be dispatched to next
+    QList< Resolver* > resolvers;
+    QHash< Resolver*, QList< query_ptr > > dispatch;
+    foreach ( const query_ptr& q, qlist )
     {
-        tLog( LOGVERBOSE ) << "Dispatching to resolver" << r->name() << q->toString() << q->solved() << q->id();
+        Resolver* r = 0;
+        if ( !q->resolvingFinished() )
+            r = nextResolver( q );
+
+        if ( !r )
+        {
+            // we get here if we disable a resolver while a query is resolving
+            if ( !q->resolvingFinished() )
+            {
+                QMutexLocker lock( &m_mut );
+                m_unanswered.insert( q->id() );
+            }
+
+            setQIDState( q, 0 );
+            continue;
+        }
+
+        if ( !dispatch.contains( r ) )
+            resolvers << r;
 
         q->setCurrentResolver( r );
-        r->resolve( q );
-        emit resolving( q );
+        dispatch[ r ] << q;
+    }
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    foreach ( Resolver* r, resolvers )
+    {
+        QList< query_ptr > queries;
+        {
+            QMutexLocker lock( &m_mut );
+            ResolverStats& stats = m_resolverStats[ r ];
+
+            foreach ( const query_ptr& q, dispatch.value( r ) )
+            {
+                m_savedResolverCalls += m_duplicateQueries.value( q->id() ).count();
+
+                // resolvers without a timeout (i.e. the local database) are never throttled
+                if ( r->timeout() > 0 && !stats.canDispatch() )
+                {
+                    m_dispatchTimes.insert( qMakePair( q->id(), r ), 0 );
+                    m_resolverBacklog[ r ] << q;
+                    m_backlogged.insert( q->id() );
+                    continue;
+                }
+
+                stats.dispatched();
+                m_dispatchTimes.insert( qMakePair( q->id(), r ), now );
+                if ( m_traces.contains( q->id() ) )
+                    m_traces[ q->id() ].dispatched( r->name(), now );
+                queries << q;
+            }
+        }
+
+        dispatchToResolver( r, queries );
+    }
 
-        if ( r->timeout() > 0 )
+    shuntNext();
+}
+
+
+void
+Pipeline::dispatchToResolver( Tomahawk::Resolver* r, const QList< query_ptr >& queries )
+{
+    if ( queries.isEmpty() )
+        return;
+
+    // a stalled resolver times out the queries it got, which lets its backlog move on
+    if ( r->timeout() > 0 )
+    {
+        unsigned int timeout;
         {
-            m_qidsTimeout.insert( q->id(), true );
-            new FuncTimeout( r->timeout(), boost::bind( &Pipeline::timeoutShunt, this, q ), this );
+            QMutexLocker lock( &m_mut );
+            timeout = m_resolverStats[ r ].adaptiveTimeout( r->timeout() );
         }
+
+        foreach ( const query_ptr& q, queries )
+            new FuncTimeout( timeout, boost::bind( &Pipeline::timeoutShunt, this, q, r ), this );
+    }
+
+    if ( queries.count() == 1 )
+    {
+        tLog( LOGVERBOSE ) << "Dispatching to resolver" << r->name() << queries.first()->toString() << queries.first()->solved() << queries.first()->id();
+        r->resolve( queries.first() );
     }
     else
     {
-        // we get here if we disable a resolver while a query is resolving
-        setQIDState( q, 0 );
+        tLog( LOGVERBOSE ) << "Dispatching batch of" << queries.count() << "queries to resolver" << r->name();
+        r->resolve( queries );
+    }
+
+    foreach ( const query_ptr& q, queries )
+        emit resolving( q );
+}
+
+
+void
+Pipeline::dispatchBacklog( Tomahawk::Resolver* r )
+{
+    if ( !m_running )
         return;
+
+    QList< query_ptr > queries;
+    {
+        QMutexLocker lock( &m_mut );
+
+        if ( !m_resolverBacklog.contains( r ) )
+            return;
+
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        ResolverStats& stats = m_resolverStats[ r ];
+        QList< query_ptr >& backlog = m_resolverBacklog[ r ];
+        while ( !backlog.isEmpty() && stats.canDispatch() )
+        {
+            const query_ptr q = backlog.takeFirst();
+            const QPair< QID, Resolver* > key = qMakePair( q->id(), r );
+            m_backlogged.remove( q->id() );
+
+            // skip queries that timed out or got solved while waiting
+            if ( !m_dispatchTimes.contains( key ) || !m_qidsState.contains( q->id() ) )
+            {
+                m_dispatchTimes.remove( key );
+                continue;
+            }
+
+            stats.dispatched();
+            m_dispatchTimes.insert( key, now );
+            if ( m_traces.contains( q->id() ) )
+                m_traces[ q->id() ].dispatched( r->name(), now );
+            queries << q;
+        }
+
+        if ( backlog.isEmpty() )
+            m_resolverBacklog.remove( r );
     }
 
-    shuntNext();
+    dispatchToResolver( r, queries );
+}
+
+
+void
+Pipeline::addMissingResults( const Tomahawk::query_ptr& query, const QList< result_ptr >& results )
+{
+    // a duplicate attaching while results arrive may see them both in the leader and as forwarded ones
+    const QList< result_ptr > known = query->results();
+
+    QList< result_ptr > missing;
+    foreach ( const result_ptr& result, results )
+    {
+        if ( !known.contains( result ) )
+            missing << result;
+    }
+
+    if ( !missing.isEmpty() )
+        query->addResults( missing );
+}
+
+
+QString
+Pipeline::queryKey( const Tomahawk::query_ptr& query )
+{
+    // full-text queries and queries with a result-hint are never coalesced
+    if ( query->isFullTextQuery() || !query->resultHint().isEmpty() )
+        return QString();
+
+    return query->artistSortname() + "\t" + query->trackSortname() + "\t" + query->albumSortname();
+}
+
+
+Tomahawk::result_ptr
+Pipeline::result( const RID& rid )
+{
+    RegisteredResult entry;
+    {
+        QMutexLocker lock( &m_mut );
+
+        if ( !m_rids.contains( rid ) )
+            return result_ptr();
+
+        RegisteredResult& registered = m_rids[ rid ];
+        registered.lastAccess = QDateTime::currentMSecsSinceEpoch();
+
+        const result_ptr r = registered.result.toStrongRef();
+        if ( !r.isNull() || registered.reresolving )
+            return r;
+
+        registered.reresolving = true;
+        entry = registered;
+    }
+
+    tDebug() << "Resolving released result again:" << rid << entry.artist << entry.track << entry.album;
+    query_ptr q = Query::get( entry.artist, entry.track, entry.album, uuid(), false );
+    {
+        QMutexLocker lock( &m_mut );
+        m_reresolving.insert( q->id(), rid );
+    }
+
+    resolve( q, ResolvePriority::Playing, true );
+
+    // known misses finish right away
+    if ( q->resolvingFinished() )
+    {
+        QMutexLocker lock( &m_mut );
+        bindReresolvedResult( q, result_ptr() );
+    }
+
+    return result_ptr();
+}
+
+
+void
+Pipeline::registerResults( const QList< result_ptr >& results )
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    foreach ( const result_ptr& r, results )
+    {
+        RegisteredResult& entry = m_rids[ r->id() ];
+        entry.result = r.toWeakRef();
+        entry.artist = r->artist()->name();
+        entry.track = r->track();
+        entry.album = r->album()->name();
+        entry.lastAccess = now;
+        entry.reresolving = false;
+    }
+
+    if ( (unsigned int)m_rids.count() > m_maxRegisteredResults )
+    {
+        QMap< qint64, RID > byAccess;
+        QHash< RID, RegisteredResult >::const_iterator it = m_rids.constBegin();
+        for ( ; it != m_rids.constEnd(); ++it )
+            byAccess.insertMulti( it.value().lastAccess, it.key() );
+
+        // leave some room, so we don't have to prune on every single insert
+        const int keep = m_maxRegisteredResults - m_maxRegisteredResults / 10;
+        QMap< qint64, RID >::const_iterator oldest = byAccess.constBegin();
+        while ( m_rids.count() > keep && oldest != byAccess.constEnd() )
+        {
+            m_rids.remove( oldest.value() );
+            ++oldest;
+        }
+
+        tDebug( LOGVERBOSE ) << "Evicted least recently used results, now tracking" << m_rids.count();
+    }
+}
+
+
+void
+Pipeline::bindReresolvedResult( const Tomahawk::query_ptr& query, const Tomahawk::result_ptr& result )
+{
+    if ( !m_reresolving.contains( query->id() ) )
+        return;
+
+    const RID rid = m_reresolving.take( query->id() );
+    if ( !m_rids.contains( rid ) )
+        return;
+
+    // a released result was asked for, let its RID point to the new one
+    RegisteredResult& entry = m_rids[ rid ];
+    entry.pinned = result;
+    entry.result = result.toWeakRef();
+    entry.reresolving = false;
+}
+
+
+void
+Pipeline::finishTrace( const QID& qid, ResolveTrace::Outcome outcome )
+{
+    m_outcomes[ outcome ]++;
+
+    if ( !m_traces.contains( qid ) )
+        return;
+
+    ResolveTrace trace = m_traces.take( qid );
+    trace.finished( outcome, QDateTime::currentMSecsSinceEpoch() );
+
+    m_finishedTraces << trace;
+    while ( m_finishedTraces.count() > MAX_FINISHED_TRACES )
+        m_finishedTraces.removeFirst();
+}
+
+
+void
+Pipeline::setTracingEnabled( bool enabled )
+{
+    QMutexLocker lock( &m_mut );
+
+    tDebug() << Q_FUNC_INFO << enabled;
+    m_tracing = enabled;
+    if ( !enabled )
+    {
+        m_traces.clear();
+        m_finishedTraces.clear();
+    }
+}
+
+
+QVariantMap
+Pipeline::metrics()
+{
+    QMutexLocker lock( &m_mut );
+
+    QVariantMap m;
+    m.insert( "pending", m_queries_pending.count() );
+    m.insert( "active", m_qidsState.count() );
+    m.insert( "savedResolverCalls", m_savedResolverCalls );
+    m.insert( "negativeCacheHits", m_negativeCacheHits );
+    m.insert( "registeredResults", m_rids.count() );
+
+    QVariantMap outcomes;
+    outcomes.insert( "solved", m_outcomes.value( ResolveTrace::Solved ) );
+    outcomes.insert( "playable", m_outcomes.value( ResolveTrace::Playable ) );
+    outcomes.insert( "unresolved", m_outcomes.value( ResolveTrace::Unresolved ) );
+    outcomes.insert( "knownMiss", m_outcomes.value( ResolveTrace::KnownMiss ) );
+    m.insert( "outcomes", outcomes );
+
+    QVariantList resolvers;
+    foreach ( Resolver* r, m_resolvers )
+    {
+        QVariantMap rm = m_resolverStats.value( r ).toVariant();
+        rm.insert( "name", r->name() );
+        rm.insert( "weight", r->weight() );
+        rm.insert( "timeout", r->timeout() );
+        rm.insert( "adaptiveTimeout", m_resolverStats.value( r ).adaptiveTimeout( r->timeout() ) );
+        resolvers << rm;
+    }
+    m.insert( "resolvers", resolvers );
+
+    if ( m_tracing )
+    {
+        QList< int > queueTimes;
+        QVariantList traces;
+        foreach ( const ResolveTrace& trace, m_finishedTraces )
+        {
+            if ( trace.queueTime() >= 0 )
+                queueTimes << trace.queueTime();
+            traces << trace.toVariant();
+        }
+        m.insert( "traces", traces );
+
+        QVariantList active;
+        foreach ( const ResolveTrace& trace, m_traces )
+            active << trace.toVariant();
+        m.insert( "activeTraces", active );
+
+        if ( !queueTimes.isEmpty() )
+        {
+            qSort( queueTimes );
+            m.insert( "queueTimeP50", queueTimes.at( queueTimes.count() / 2 ) );
+            m.insert( "queueTimeP95", queueTimes.at( qMin( queueTimes.count() - 1, queueTimes.count() * 95 / 100 ) ) );
+        }
+    }
+
+    return m;
+}
+
+
+bool
+Pipeline::dumpMetrics( const QString& path )
+{
+    QJson::Serializer serializer;
+    const QByteArray json = serializer.serialize( metrics() );
+
+    QFile file( path );
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+    {
+        tLog() << "Could not write pipeline metrics to:" << path;
+        return false;
+    }
+
+    file.write( json );
+    tDebug() << "Wrote pipeline metrics to:" << path;
+    return true;
+}
+
+
+void
+Pipeline::pruneResults()
+{
+    QMutexLocker lock( &m_mut );
+
+    const qint64 expired = QDateTime::currentMSecsSinceEpoch() - m_registeredResultTimeout;
+    const int before = m_rids.count();
+
+    QMutableHashIterator< RID, RegisteredResult > it( m_rids );
+    while ( it.hasNext() )
+    {
+        it.next();
+        if ( it.value().lastAccess < expired )
+            it.remove();
+    }
+
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Expired" << before - m_rids.count() << "results, still tracking" << m_rids.count();
+}
+
+
+QString
+Pipeline::negativeCacheKey( const Tomahawk::query_ptr& query ) const
+{
+    const QString key = queryKey( query );
+    if ( key.isEmpty() )
+        return QString();
+
+    return key + "\t" + m_resolverSetKey;
+}
+
+
+bool
+Pipeline::isKnownMiss( const Tomahawk::query_ptr& query )
+{
+    const QString key = negativeCacheKey( query );
+    if ( key.isEmpty() )
+        return false;
+
+    qint64* lastMiss = m_negativeCache.object( key );
+    if ( !lastMiss )
+        return false;
+
+    if ( QDateTime::currentMSecsSinceEpoch() - *lastMiss > NEGATIVE_CACHE_TTL )
+    {
+        m_negativeCache.remove( key );
+        return false;
+    }
+
+    tLog( LOGVERBOSE ) << "Not resolving recently missed track:" << query->toString();
+    return true;
+}
+
+
+void
+Pipeline::updateResolverSetKey()
+{
+    QStringList resolvers;
+    foreach ( Resolver* r, m_resolvers )
+        resolvers << QString::number( (quintptr)r, 16 );
+
+    resolvers.sort();
+    m_resolverSetKey = resolvers.join( "," );
+}
+
+
+void
+Pipeline::clearNegativeCache()
+{
+    QMutexLocker lock( &m_mut );
+
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << m_negativeCache.count();
+    m_negativeCache.clear();
+}
+
+
+void
+Pipeline::onSourceAdded( const Tomahawk::source_ptr& source )
+{
+    const collection_ptr collection = source->collection();
+    if ( !collection.isNull() )
+    {
+        connect( collection.data(), SIGNAL( tracksAdded( QList<unsigned int> ) ), SLOT( clearNegativeCache() ), Qt::UniqueConnection );
+        connect( collection.data(), SIGNAL( tracksRemoved( QList<unsigned int> ) ), SLOT( clearNegativeCache() ), Qt::UniqueConnection );
+        connect( collection.data(), SIGNAL( changed() ), SLOT( clearNegativeCache() ), Qt::UniqueConnection );
+    }
+
+    clearNegativeCache();
 }
 
 
@@ -466,23 +1138,63 @@ Pipeline::setQIDState( const Tomahawk::query_ptr& query, int state )
 {
     QMutexLocker lock( &m_mut );
 
-    if ( m_qidsTimeout.contains( query->id() ) )
-        m_qidsTimeout.remove( query->id() );
-
     if ( state > 0 )
     {
         m_qidsState.insert( query->id(), state );
 
-        new FuncTimeout( 0, boost::bind( &Pipeline::shunt, this, query ), this );
+        QList< query_ptr > qlist;
+        qlist << query;
+        new FuncTimeout( 0, boost::bind( &Pipeline::shunt, this, qlist ), this );
     }
     else
     {
-        m_qidsState.remove( query->id() );
+        const bool wasActive = m_qidsState.remove( query->id() ) > 0;
+        m_backlogged.remove( query->id() );
         query->onResolvingFinished();
 
+        if ( wasActive )
+        {
+            if ( query->solved() )
+                finishTrace( query->id(), ResolveTrace::Solved );
+            else if ( query->playable() )
+                finishTrace( query->id(), ResolveTrace::Playable );
+            else
+                finishTrace( query->id(), ResolveTrace::Unresolved );
+        }
+
+        // nothing found again for a released result
+        bindReresolvedResult( query, result_ptr() );
+
+        // only if every resolver really answered, a timeout or a removed resolver may just be temporary
+        const bool allAnswered = !m_unanswered.remove( query->id() );
+        if ( allAnswered && query->results().isEmpty() )
+        {
+            const QString missKey = negativeCacheKey( query );
+            if ( !missKey.isEmpty() )
+                m_negativeCache.insert( missKey, new qint64( QDateTime::currentMSecsSinceEpoch() ) );
+        }
+
         if ( !m_queries_temporary.contains( query ) )
             m_qids.remove( query->id() );
 
+        const QString key = queryKey( query );
+        if ( !key.isEmpty() && m_queriesByKey.value( key ) == query )
+            m_queriesByKey.remove( key );
+
+        // the duplicates already got all results as they arrived
+        const QList< query_ptr > duplicates = m_duplicateQueries.take( query->id() );
+        if ( !duplicates.isEmpty() )
+            tLog( LOGVERBOSE ) << "Finished" << duplicates.count() << "coalesced duplicates of" << query->toString() << "- resolver calls saved so far:" << m_savedResolverCalls;
+
+        foreach ( const query_ptr& dq, duplicates )
+        {
+            dq->onResolvingFinished();
+            bindReresolvedResult( dq, result_ptr() );
+
+            if ( !m_queries_temporary.contains( dq ) )
+                m_qids.remove( dq->id() );
+        }
+
         new FuncTimeout( 0, boost::bind( &Pipeline::shuntNext, this ), this );
     }
 }
@@ -21,10 +21,17 @@
 
 #include "Typedefs.h"
 #include "Query.h"
+#include "PipelineQueue.h"
+#include "ResolverStats.h"
+#include "ResolveTrace.h"
 
 #include <QObject>
+#include <QCache>
 #include <QList>
+#include <QHash>
+#include <QSet>
 #include <QMap>
+#include <QPair>
 #include <QMutex>
 #include <QTimer>
 
@@ -52,8 +59,12 @@ public:
 
     unsigned int pendingQueryCount() const { return m_queries_pending.count(); }
     unsigned int activeQueryCount() const { return m_qidsState.count(); }
+    // how many resolver calls were avoided by coalescing duplicate queries
+    unsigned int savedResolverCalls() const { return m_savedResolverCalls; }
+    // how many queries were answered from the cache of recent misses
+    unsigned int negativeCacheHits() const { return m_negativeCacheHits; }
 
-    void reportResults( QID qid, const QList< result_ptr >& results );
+    void reportResults( QID qid, Tomahawk::Resolver* r, const QList< result_ptr >& results );
     void reportAlbums( QID qid, const QList< album_ptr >& albums );
     void reportArtists( QID qid, const QList< artist_ptr >& artists );
 
@@ -72,20 +83,42 @@ public:
         return m_qids.value( qid );
     }
 
-    result_ptr result( const RID& rid ) const
+    // returns a null result_ptr for unknown RIDs, and for results that already got
+    // released - those get resolved again in the background, so retry later
+    result_ptr result( const RID& rid );
+    unsigned int registeredResultCount() const { return m_rids.count(); }
+
+    // when enabled, the way of every query through the pipeline is recorded
+    void setTracingEnabled( bool enabled );
+    bool isTracingEnabled() const { return m_tracing; }
+    // aggregate counters, per-resolver stats and the most recent traces
+    QVariantMap metrics();
+    bool dumpMetrics( const QString& path );
+
+    ResolverStats resolverStats( Tomahawk::Resolver* r ) const
     {
-        return m_rids.value( rid );
+        return m_resolverStats.value( r );
     }
 
 public slots:
     void resolve( const query_ptr& q, bool prioritized = true, bool temporaryQuery = false );
     void resolve( const QList<query_ptr>& qlist, bool prioritized = true, bool temporaryQuery = false );
     void resolve( QID qid, bool prioritized = true, bool temporaryQuery = false );
+    void resolve( const query_ptr& q, Tomahawk::ResolvePriority::Priority priority, bool temporaryQuery = false );
+    void resolve( const QList<query_ptr>& qlist, Tomahawk::ResolvePriority::Priority priority, bool temporaryQuery = false );
+
+    // moves a query that is still waiting to be dispatched into another priority class
+    void setPriority( const query_ptr& q, Tomahawk::ResolvePriority::Priority priority );
+    // like setPriority, but never lowers the priority of a query
+    void promote( const query_ptr& q, Tomahawk::ResolvePriority::Priority priority );
 
     void start();
     void stop();
     void databaseReady();
 
+    // forgets which tracks recently couldn't be resolved
+    void clearNegativeCache();
+
 signals:
     void idle();
     void resolving( const Tomahawk::query_ptr& query );
@@ -94,14 +127,30 @@ signals:
     void resolverRemoved( Resolver* );
 
 private slots:
-    void timeoutShunt( const query_ptr& q );
-    void shunt( const query_ptr& q );
+    void timeoutShunt( const query_ptr& q, Tomahawk::Resolver* r );
+    void shunt( const QList< query_ptr >& qlist );
     void shuntNext();
 
     void onTemporaryQueryTimer();
+    void pruneResults();
+    void onSourceAdded( const Tomahawk::source_ptr& source );
 
 private:
     Tomahawk::Resolver* nextResolver( const Tomahawk::query_ptr& query ) const;
+    static QString queryKey( const Tomahawk::query_ptr& query );
+    // adds those of results a coalesced duplicate doesn't have yet
+    static void addMissingResults( const Tomahawk::query_ptr& query, const QList< result_ptr >& results );
+
+    // hands queries to a resolver, their timeout starts now
+    void dispatchToResolver( Tomahawk::Resolver* r, const QList< query_ptr >& queries );
+    void dispatchBacklog( Tomahawk::Resolver* r );
+
+    QString negativeCacheKey( const Tomahawk::query_ptr& query ) const;
+    bool isKnownMiss( const Tomahawk::query_ptr& query );
+    void updateResolverSetKey();
+    void registerResults( const QList< result_ptr >& results );
+    void finishTrace( const QID& qid, ResolveTrace::Outcome outcome );
+    void bindReresolvedResult( const Tomahawk::query_ptr& query, const Tomahawk::result_ptr& result );
 
     void setQIDState( const Tomahawk::query_ptr& query, int state );
     int incQIDState( const Tomahawk::query_ptr& query );
@@ -110,15 +159,58 @@ private:
     QList< Resolver* > m_resolvers;
     QList< QWeakPointer<Tomahawk::ExternalResolver> > m_scriptResolvers;
     QList< ResolverFactoryFunc > m_resolverFactories;
-    QMap< QID, bool > m_qidsTimeout;
     QMap< QID, unsigned int > m_qidsState;
     QMap< QID, query_ptr > m_qids;
-    QMap< RID, result_ptr > m_rids;
 
-    QMutex m_mut; // for m_qids, m_rids
+    // all results handed out, by RID. Only weak references are kept, so the metadata
+    // is stored alongside to resolve the track again once a result has been released
+    struct RegisteredResult
+    {
+        QWeakPointer< Result > result;
+        result_ptr pinned; // a re-resolved result, kept until it expires
+        QString artist;
+        QString track;
+        QString album;
+        qint64 lastAccess;
+        bool reresolving;
+    };
+    QHash< RID, RegisteredResult > m_rids;
+    QHash< QID, RID > m_reresolving;
+    unsigned int m_maxRegisteredResults;
+    qint64 m_registeredResultTimeout;
+    QTimer m_resultCleanupTimer;
+
+    // in-flight queries by their normalized artist/track/album, and the
+    // duplicates waiting for them to finish resolving
+    QHash< QString, query_ptr > m_queriesByKey;
+    QHash< QID, QList< query_ptr > > m_duplicateQueries;
+    unsigned int m_savedResolverCalls;
+
+    // per-resolver latency and concurrency bookkeeping. m_dispatchTimes holds when
+    // a query was handed to a resolver, or 0 while it waits in that resolver's backlog
+    QHash< Resolver*, ResolverStats > m_resolverStats;
+    QHash< QPair< QID, Resolver* >, qint64 > m_dispatchTimes;
+    QHash< Resolver*, QList< query_ptr > > m_resolverBacklog;
+    // queries waiting in a backlog don't count against m_maxConcurrentQueries
+    QSet< QID > m_backlogged;
+
+    // when tracks were last not found by any resolver, keyed by their normalized
+    // artist/track/album and the set of resolvers that were asked
+    QCache< QString, qint64 > m_negativeCache;
+    // queries some resolver didn't answer for, they must not end up in the negative cache
+    QSet< QID > m_unanswered;
+    QString m_resolverSetKey;
+    unsigned int m_negativeCacheHits;
+
+    bool m_tracing;
+    QHash< QID, ResolveTrace > m_traces;
+    QList< ResolveTrace > m_finishedTraces;
+    QMap< ResolveTrace::Outcome, unsigned int > m_outcomes;
+
+    QMutex m_mut; // for m_qids, m_rids, m_traces, m_finishedTraces, m_outcomes, m_reresolving, m_queriesByKey, m_duplicateQueries, m_resolverStats, m_dispatchTimes, m_resolverBacklog, m_backlogged, m_negativeCache, m_unanswered
 
     // store queries here until DB index is loaded, then shunt them all
-    QList< query_ptr > m_queries_pending;
+    PipelineQueue m_queries_pending;
     // store temporary queries here and clean up after timeout threshold
     QList< query_ptr > m_queries_temporary;
 
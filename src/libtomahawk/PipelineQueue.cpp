@@ -0,0 +1,181 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2026, agent <agent@local>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PipelineQueue.h"
+
+#include <QDateTime>
+
+#include "Query.h"
+
+#define AGING_INTERVAL 5000
+
+using namespace Tomahawk;
+
+
+PipelineQueue::PipelineQueue()
+    : m_seq( 0 )
+{
+}
+
+
+bool
+PipelineQueue::contains( const query_ptr& query ) const
+{
+    return m_entries.contains( query->id() );
+}
+
+
+void
+PipelineQueue::enqueue( const QList< query_ptr >& queries, ResolvePriority::Priority priority )
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const bool front = ( priority != ResolvePriority::Background );
+
+    for ( int i = 0; i < queries.count(); i++ )
+    {
+        // prepend batches back to front, so they keep their order
+        const query_ptr& query = queries.at( front ? queries.count() - 1 - i : i );
+
+        if ( contains( query ) )
+            promote( query, priority );
+        else
+            push( query, priority, front, now );
+    }
+}
+
+
+bool
+PipelineQueue::setPriority( const query_ptr& query, ResolvePriority::Priority priority )
+{
+    if ( !contains( query ) )
+        return false;
+
+    const Entry entry = m_entries.value( query->id() );
+    if ( entry.priority == priority && priority == ResolvePriority::Background )
+        return true;
+
+    // keep the original queue time, so the query doesn't lose what it aged so far
+    push( query, priority, priority != ResolvePriority::Background, entry.queued );
+    return true;
+}
+
+
+bool
+PipelineQueue::promote( const query_ptr& query, ResolvePriority::Priority priority )
+{
+    if ( !contains( query ) )
+        return false;
+
+    if ( priority <= m_entries.value( query->id() ).priority )
+        setPriority( query, priority );
+
+    return true;
+}
+
+
+query_ptr
+PipelineQueue::take()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    QList< Item >* best = 0;
+    bool fromBack = false;
+    qint64 bestPriority = 0;
+
+    for ( int p = ResolvePriority::Playing; p <= ResolvePriority::Background; p++ )
+    {
+        QList< Item >& queue = m_queues[ p ];
+        trim( queue );
+        if ( queue.isEmpty() )
+            continue;
+
+        // recently prepended batches are at the front, the oldest entries may be at the back
+        const qint64 frontPriority = effectivePriority( queue.first(), now );
+        const qint64 backPriority = effectivePriority( queue.last(), now );
+
+        if ( !best || frontPriority < bestPriority )
+        {
+            best = &queue;
+            fromBack = false;
+            bestPriority = frontPriority;
+        }
+        if ( backPriority < bestPriority )
+        {
+            best = &queue;
+            fromBack = true;
+            bestPriority = backPriority;
+        }
+    }
+
+    if ( !best )
+        return query_ptr();
+
+    const Item item = fromBack ? best->takeLast() : best->takeFirst();
+    m_entries.remove( item.query->id() );
+
+    return item.query;
+}
+
+
+void
+PipelineQueue::push( const query_ptr& query, ResolvePriority::Priority priority, bool front, qint64 queued )
+{
+    Entry entry;
+    entry.priority = priority;
+    entry.seq = ++m_seq;
+    entry.queued = queued;
+    m_entries.insert( query->id(), entry );
+
+    Item item;
+    item.query = query;
+    item.seq = entry.seq;
+
+    if ( front )
+        m_queues[ priority ].prepend( item );
+    else
+        m_queues[ priority ].append( item );
+}
+
+
+bool
+PipelineQueue::isStale( const Item& item ) const
+{
+    QHash< QID, Entry >::const_iterator it = m_entries.constFind( item.query->id() );
+    return ( it == m_entries.constEnd() || it.value().seq != item.seq );
+}
+
+
+void
+PipelineQueue::trim( QList< Item >& queue )
+{
+    while ( !queue.isEmpty() && isStale( queue.first() ) )
+        queue.removeFirst();
+    while ( !queue.isEmpty() && isStale( queue.last() ) )
+        queue.removeLast();
+}
+
+
+qint64
+PipelineQueue::effectivePriority( const Item& item, qint64 now ) const
+{
+    const Entry entry = m_entries.value( item.query->id() );
+
+    // every AGING_INTERVAL spent waiting lifts a query by one priority class, but not past Visible
+    const qint64 aged = (qint64)entry.priority - ( now - entry.queued ) / AGING_INTERVAL;
+    return qMax( aged, (qint64)qMin( entry.priority, ResolvePriority::Visible ) );
+}
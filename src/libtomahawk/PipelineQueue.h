@@ -0,0 +1,87 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2026, agent <agent@local>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINEQUEUE_H
+#define PIPELINEQUEUE_H
+
+#include "Typedefs.h"
+
+#include <QHash>
+#include <QList>
+
+namespace Tomahawk
+{
+
+/*
+    Pending queries of the Pipeline, one queue per ResolvePriority class.
+
+    Membership checks and re-prioritizing are O(1): every queued query has an
+    entry in m_entries, re-queueing it only bumps its sequence number, and stale
+    copies left behind in the class queues get skipped when they surface.
+
+    Queries age while they wait, so background work is never starved: every
+    AGING_INTERVAL ms of waiting lifts a query by one priority class, up to
+    Visible. Nothing overtakes the queries of what is about to be played.
+*/
+class PipelineQueue
+{
+public:
+    PipelineQueue();
+
+    bool isEmpty() const { return m_entries.isEmpty(); }
+    int count() const { return m_entries.count(); }
+    bool contains( const Tomahawk::query_ptr& query ) const;
+
+    // queries of the Background class are appended, all other classes serve
+    // the most recently enqueued batch first
+    void enqueue( const QList< Tomahawk::query_ptr >& queries, ResolvePriority::Priority priority );
+
+    // moves an already queued query into another priority class
+    bool setPriority( const Tomahawk::query_ptr& query, ResolvePriority::Priority priority );
+    // like setPriority, but never lowers the priority of a query
+    bool promote( const Tomahawk::query_ptr& query, ResolvePriority::Priority priority );
+
+    Tomahawk::query_ptr take();
+
+private:
+    struct Entry
+    {
+        ResolvePriority::Priority priority;
+        quint64 seq;
+        qint64 queued;
+    };
+
+    struct Item
+    {
+        Tomahawk::query_ptr query;
+        quint64 seq;
+    };
+
+    void push( const Tomahawk::query_ptr& query, ResolvePriority::Priority priority, bool front, qint64 queued );
+    bool isStale( const Item& item ) const;
+    void trim( QList< Item >& queue );
+    qint64 effectivePriority( const Item& item, qint64 now ) const;
+
+    QHash< QID, Entry > m_entries;
+    QList< Item > m_queues[ ResolvePriority::Background + 1 ];
+    quint64 m_seq;
+};
+
+}; //ns
+
+#endif // PIPELINEQUEUE_H
@@ -534,7 +534,7 @@ Playlist::resolve()
         qlist << p->query();
     }
 
-    Pipeline::instance()->resolve( qlist );
+    Pipeline::instance()->resolve( qlist, ResolvePriority::Background );
 }
 
 
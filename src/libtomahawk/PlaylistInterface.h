@@ -49,6 +49,8 @@ public:
     virtual bool hasNextItem() { return true; }
     virtual Tomahawk::result_ptr nextItem();
     virtual Tomahawk::result_ptr siblingItem( int itemsAway ) = 0;
+    /// the queries that will most likely be played next, without moving the current item. Used for prefetching
+    virtual QList< Tomahawk::query_ptr > upcomingQueries( int count ) { Q_UNUSED( count ); return QList< Tomahawk::query_ptr >(); }
 
     virtual PlaylistModes::RepeatMode repeatMode() const = 0;
 
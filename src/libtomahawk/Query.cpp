@@ -35,6 +35,7 @@
 #include "SourceList.h"
 #include "audio/AudioEngine.h"
 
+#include "utils/EditDistance.h"
 #include "utils/Logger.h"
 
 using namespace Tomahawk;
@@ -502,37 +503,38 @@ Query::toString() const
 
 
 // TODO make clever (ft. featuring live (stuff) etc)
-float
-Query::howSimilar( const Tomahawk::result_ptr& r )
+// share of the longer name that doesn't need editing. Anything below minSimilarity
+// is only estimated, the result is guaranteed to be below minSimilarity then, too
+static float
+similarity( const QString& name, const QString& other, float minSimilarity = 0.0 )
 {
-    // result values
-    const QString rArtistname = r->artist()->sortname();
-    const QString rAlbumname  = DatabaseImpl::sortname( r->album()->name() );
-    const QString rTrackname  = DatabaseImpl::sortname( r->track() );
+    const int ml = qMax( name.length(), other.length() );
 
-    // normal edit distance
-    int artdist = levenshtein( m_artistSortname, rArtistname );
-    int albdist = levenshtein( m_albumSortname, rAlbumname );
-    int trkdist = levenshtein( m_trackSortname, rTrackname );
+    int maxDistance = -1;
+    if ( minSimilarity > 0 )
+        maxDistance = qMax( 0, (int)( ml * ( 1.0 - minSimilarity ) ) + 1 );
+
+    const int dist = TomahawkUtils::editDistance( name, other, maxDistance );
+    return (float)( ml - dist ) / ml;
+}
 
-    // max length of name
-    int mlart = qMax( m_artistSortname.length(), rArtistname.length() );
-    int mlalb = qMax( m_albumSortname.length(), rAlbumname.length() );
-    int mltrk = qMax( m_trackSortname.length(), rTrackname.length() );
 
-    // distance scores
-    float dcart = (float)( mlart - artdist ) / mlart;
-    float dcalb = (float)( mlalb - albdist ) / mlalb;
-    float dctrk = (float)( mltrk - trkdist ) / mltrk;
+float
+Query::howSimilar( const Tomahawk::result_ptr& r, float minScore )
+{
+    // result values
+    const QString rArtistname = r->artist()->sortname();
+    const QString rAlbumname  = r->album()->sortname();
+    const QString rTrackname  = r->trackSortname();
 
     if ( isFullTextQuery() )
     {
-        const QString artistTrackname = DatabaseImpl::sortname( fullTextQuery() );
-        const QString rArtistTrackname  = DatabaseImpl::sortname( r->artist()->name() + " " + r->track() );
+        const float dcart = similarity( m_artistSortname, rArtistname );
+        const float dcalb = similarity( m_albumSortname, rAlbumname );
+        const float dctrk = similarity( m_trackSortname, rTrackname );
 
-        int atrdist = levenshtein( artistTrackname, rArtistTrackname );
-        int mlatr = qMax( artistTrackname.length(), rArtistTrackname.length() );
-        float dcatr = (float)( mlatr - atrdist ) / mlatr;
+        // the track sortname of a full-text query is its whole normalized text
+        const float dcatr = similarity( m_trackSortname, r->artistTrackSortname() );
 
         float res = qMax( dcart, dcalb );
         res = qMax( res, dcatr );
@@ -540,11 +542,21 @@ Query::howSimilar( const Tomahawk::result_ptr& r )
     }
     else
     {
+        // weighted, so album match is worth less than track title.
+        // Give up as soon as even perfect matches for the rest can't make up for it
+        const float dctrk = similarity( m_trackSortname, rTrackname, ( minScore * 10 - 5 ) / 5 );
+        if ( ( 5 + dctrk * 5 ) / 10 < minScore )
+            return ( 5 + dctrk * 5 ) / 10;
+
+        const float dcart = similarity( m_artistSortname, rArtistname, ( minScore * 10 - 1 - dctrk * 5 ) / 4 );
+        if ( ( dcart * 4 + 1 + dctrk * 5 ) / 10 < minScore )
+            return ( dcart * 4 + 1 + dctrk * 5 ) / 10;
+
         // don't penalize for missing album name
-        if ( m_albumSortname.isEmpty() )
-            dcalb = 1.0;
+        float dcalb = 1.0;
+        if ( !m_albumSortname.isEmpty() )
+            dcalb = similarity( m_albumSortname, rAlbumname, minScore * 10 - dcart * 4 - dctrk * 5 );
 
-        // weighted, so album match is worth less than track title
         float combined = ( dcart * 4 + dcalb + dctrk * 5 ) / 10;
         return combined;
     }
@@ -930,83 +942,3 @@ Query::infoSystemFinished( QString target )
 
     emit updated();
 }
-
-
-int
-Query::levenshtein( const QString& source, const QString& target )
-{
-    // Step 1
-    const int n = source.length();
-    const int m = target.length();
-
-    if ( n == 0 )
-        return m;
-    if ( m == 0 )
-        return n;
-
-    // Good form to declare a TYPEDEF
-    typedef QVector< QVector<int> > Tmatrix;
-    Tmatrix matrix;
-    matrix.resize( n + 1 );
-
-    // Size the vectors in the 2.nd dimension. Unfortunately C++ doesn't
-    // allow for allocation on declaration of 2.nd dimension of vec of vec
-    for ( int i = 0; i <= n; i++ )
-    {
-        QVector<int> tmp;
-        tmp.resize( m + 1 );
-        matrix.insert( i, tmp );
-    }
-
-    // Step 2
-    for ( int i = 0; i <= n; i++ )
-        matrix[i][0] = i;
-    for ( int j = 0; j <= m; j++ )
-        matrix[0][j] = j;
-
-    // Step 3
-    for ( int i = 1; i <= n; i++ )
-    {
-        const QChar s_i = source[i - 1];
-
-        // Step 4
-        for ( int j = 1; j <= m; j++ )
-        {
-            const QChar t_j = target[j - 1];
-
-            // Step 5
-            int cost;
-            if ( s_i == t_j )
-                cost = 0;
-            else
-                cost = 1;
-
-            // Step 6
-            const int above = matrix[i - 1][j];
-            const int left = matrix[i][j - 1];
-            const int diag = matrix[i - 1][j - 1];
-
-            int cell = ( ( ( left + 1 ) > ( diag + cost ) ) ? diag + cost : left + 1 );
-            if ( above + 1 < cell )
-                cell = above + 1;
-
-            // Step 6A: Cover transposition, in addition to deletion,
-            // insertion and substitution. This step is taken from:
-            // Berghel, Hal ; Roach, David : "An Extension of Ukkonen's
-            // Enhanced Dynamic Programming ASM Algorithm"
-            // (http://www.acm.org/~hlb/publications/asm/asm.html)
-            if ( i > 2 && j > 2 )
-            {
-                int trans = matrix[i - 2][j - 2] + 1;
-
-                if ( source[ i - 2 ] != t_j ) trans++;
-                if ( s_i != target[ j - 2 ] ) trans++;
-                if ( cell > trans ) cell = trans;
-            }
-            matrix[i][j] = cell;
-        }
-    }
-
-    // Step 7
-    return matrix[n][m];
-}
@@ -107,7 +107,8 @@ public:
     QString fullTextQuery() const { return m_fullTextQuery; }
     bool isFullTextQuery() const { return !m_fullTextQuery.isEmpty(); }
     bool resolvingFinished() const { return m_resolveFinished; }
-    float howSimilar( const Tomahawk::result_ptr& r );
+    /// stops comparing once the score can't reach minScore anymore, and returns an upper bound below minScore then
+    float howSimilar( const Tomahawk::result_ptr& r, float minScore = 0.0 );
 
     QPair< Tomahawk::source_ptr, unsigned int > playedBy() const;
     Tomahawk::Resolver* currentResolver() const;
@@ -223,7 +224,6 @@ private:
     void checkResults();
 
     void updateSortNames();
-    static int levenshtein( const QString& source, const QString& target );
 
     void parseSocialActions();
 
@@ -0,0 +1,154 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2026, agent <agent@local>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ResolveTrace.h"
+
+#include <QVariantList>
+
+using namespace Tomahawk;
+
+
+ResolveTrace::ResolveTrace()
+    : m_queued( 0 )
+    , m_finished( 0 )
+    , m_outcome( Pending )
+{
+}
+
+
+ResolveTrace::ResolveTrace( const QString& qid, const QString& description, qint64 queued )
+    : m_qid( qid )
+    , m_description( description )
+    , m_queued( queued )
+    , m_finished( 0 )
+    , m_outcome( Pending )
+{
+}
+
+
+void
+ResolveTrace::dispatched( const QString& resolver, qint64 time )
+{
+    Dispatch d;
+    d.resolver = resolver;
+    d.dispatched = time;
+    d.answered = 0;
+    d.timedOut = false;
+
+    m_dispatches << d;
+}
+
+
+void
+ResolveTrace::answered( const QString& resolver, qint64 time, const QList< float >& scores )
+{
+    Dispatch* d = dispatchFor( resolver );
+    if ( !d )
+        return;
+
+    d->answered = time;
+    d->scores = scores;
+}
+
+
+void
+ResolveTrace::timedOut( const QString& resolver )
+{
+    Dispatch* d = dispatchFor( resolver );
+    if ( d )
+        d->timedOut = true;
+}
+
+
+void
+ResolveTrace::finished( Outcome outcome, qint64 time )
+{
+    m_outcome = outcome;
+    m_finished = time;
+}
+
+
+int
+ResolveTrace::queueTime() const
+{
+    if ( m_dispatches.isEmpty() )
+        return -1;
+
+    return m_dispatches.first().dispatched - m_queued;
+}
+
+
+int
+ResolveTrace::totalTime() const
+{
+    if ( m_outcome == Pending )
+        return -1;
+
+    return m_finished - m_queued;
+}
+
+
+ResolveTrace::Dispatch*
+ResolveTrace::dispatchFor( const QString& resolver )
+{
+    // the latest dispatch to that resolver that is still waiting
+    for ( int i = m_dispatches.count() - 1; i >= 0; i-- )
+    {
+        Dispatch& d = m_dispatches[ i ];
+        if ( d.resolver == resolver && !d.answered && !d.timedOut )
+            return &d;
+    }
+
+    return 0;
+}
+
+
+QVariantMap
+ResolveTrace::toVariant() const
+{
+    static const char* outcomes[] = { "pending", "solved", "playable", "unresolved", "knownmiss" };
+
+    QVariantMap m;
+    m.insert( "qid", m_qid );
+    m.insert( "query", m_description );
+    m.insert( "queued", m_queued );
+    m.insert( "queueTime", queueTime() );
+    m.insert( "totalTime", totalTime() );
+    m.insert( "outcome", outcomes[ m_outcome ] );
+
+    QVariantList dispatches;
+    foreach ( const Dispatch& d, m_dispatches )
+    {
+        QVariantMap dm;
+        dm.insert( "resolver", d.resolver );
+        dm.insert( "dispatched", d.dispatched - m_queued );
+        if ( d.answered )
+            dm.insert( "latency", d.answered - d.dispatched );
+        dm.insert( "timedOut", d.timedOut );
+
+        QVariantList scores;
+        foreach ( float score, d.scores )
+            scores << score;
+        dm.insert( "scores", scores );
+
+        dispatches << dm;
+    }
+    m.insert( "dispatches", dispatches );
+
+    return m;
+}
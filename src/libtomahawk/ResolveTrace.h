@@ -0,0 +1,80 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2026, agent <agent@local>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RESOLVETRACE_H
+#define RESOLVETRACE_H
+
+#include <QList>
+#include <QString>
+#include <QVariantMap>
+
+#include "DllMacro.h"
+
+namespace Tomahawk
+{
+
+/*
+    The way of a single query through the Pipeline: how long it was queued,
+    when it was handed to which resolver, what came back and how it ended.
+    All times are in ms since the epoch.
+*/
+class DLLEXPORT ResolveTrace
+{
+public:
+    enum Outcome { Pending = 0, Solved, Playable, Unresolved, KnownMiss };
+
+    ResolveTrace();
+    explicit ResolveTrace( const QString& qid, const QString& description, qint64 queued );
+
+    void dispatched( const QString& resolver, qint64 time );
+    void answered( const QString& resolver, qint64 time, const QList< float >& scores );
+    void timedOut( const QString& resolver );
+    void finished( Outcome outcome, qint64 time );
+
+    QString qid() const { return m_qid; }
+    Outcome outcome() const { return m_outcome; }
+    /// ms from being queued until the first resolver got it, -1 if it never was dispatched
+    int queueTime() const;
+    /// ms from being queued until resolving finished, -1 while still pending
+    int totalTime() const;
+
+    QVariantMap toVariant() const;
+
+private:
+    struct Dispatch
+    {
+        QString resolver;
+        qint64 dispatched;
+        qint64 answered;
+        bool timedOut;
+        QList< float > scores;
+    };
+
+    Dispatch* dispatchFor( const QString& resolver );
+
+    QString m_qid;
+    QString m_description;
+    qint64 m_queued;
+    qint64 m_finished;
+    Outcome m_outcome;
+    QList< Dispatch > m_dispatches;
+};
+
+}; //ns
+
+#endif // RESOLVETRACE_H
@@ -18,4 +18,14 @@
 
 #include "Resolver.h"
 
-#include "Source.h"
\ No newline at end of file
+#include "Source.h"
+
+using namespace Tomahawk;
+
+
+void
+Resolver::resolve( const QList< Tomahawk::query_ptr >& queries )
+{
+    foreach ( const query_ptr& query, queries )
+        resolve( query );
+}
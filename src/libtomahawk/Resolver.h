@@ -50,6 +50,10 @@ public:
 
 public slots:
     virtual void resolve( const Tomahawk::query_ptr& query ) = 0;
+
+    // resolves a whole batch of queries at once. The default implementation
+    // dispatches them one by one, override it if you can do better.
+    virtual void resolve( const QList< Tomahawk::query_ptr >& queries );
 };
 
 }; //ns
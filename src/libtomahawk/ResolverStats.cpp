@@ -0,0 +1,184 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2026, agent <agent@local>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ResolverStats.h"
+
+#include <QtAlgorithms>
+#include <QVariantList>
+
+#define INITIAL_CONCURRENCY 4
+#define MAX_CONCURRENCY 16
+#define MAX_SAMPLES 100
+#define MIN_SAMPLES 10
+#define MIN_TIMEOUT 500
+#define SCORE_BUCKETS 10
+
+using namespace Tomahawk;
+
+
+ResolverStats::ResolverStats()
+    : m_inFlight( 0 )
+    , m_limit( INITIAL_CONCURRENCY )
+    , m_dispatched( 0 )
+    , m_answered( 0 )
+    , m_timedOut( 0 )
+    , m_hits( 0 )
+    , m_nextSample( 0 )
+{
+    for ( int i = 0; i <= latencyBuckets().count(); i++ )
+        m_latencyHistogram << 0;
+    for ( int i = 0; i < SCORE_BUCKETS; i++ )
+        m_scoreHistogram << 0;
+}
+
+
+QList< int >
+ResolverStats::latencyBuckets()
+{
+    static QList< int > buckets = QList< int >() << 50 << 100 << 250 << 500 << 1000 << 2500 << 5000;
+    return buckets;
+}
+
+
+void
+ResolverStats::dispatched()
+{
+    m_dispatched++;
+    m_inFlight++;
+}
+
+
+void
+ResolverStats::answered( int latency, bool hasResults )
+{
+    m_answered++;
+    if ( hasResults )
+        m_hits++;
+    if ( m_inFlight > 0 )
+        m_inFlight--;
+
+    // additive increase: one more slot per window of answers in time
+    m_limit = qMin( (float)MAX_CONCURRENCY, m_limit + 1.0f / m_limit );
+
+    // the last bucket takes everything slower than the slowest bound
+    const QList< int > buckets = latencyBuckets();
+    int bucket = 0;
+    while ( bucket < buckets.count() && latency >= buckets.at( bucket ) )
+        bucket++;
+    m_latencyHistogram[ bucket ]++;
+
+    if ( m_latencies.count() < MAX_SAMPLES )
+    {
+        m_latencies << latency;
+    }
+    else
+    {
+        m_latencies[ m_nextSample ] = latency;
+        m_nextSample = ( m_nextSample + 1 ) % MAX_SAMPLES;
+    }
+}
+
+
+void
+ResolverStats::timedOut()
+{
+    m_timedOut++;
+    if ( m_inFlight > 0 )
+        m_inFlight--;
+
+    // multiplicative decrease
+    m_limit = qMax( 1.0f, m_limit / 2 );
+}
+
+
+void
+ResolverStats::scored( float score )
+{
+    const int bucket = qBound( 0, (int)( score * SCORE_BUCKETS ), SCORE_BUCKETS - 1 );
+    m_scoreHistogram[ bucket ]++;
+}
+
+
+float
+ResolverStats::successRate() const
+{
+    const unsigned int total = m_answered + m_timedOut;
+    if ( !total )
+        return 1.0;
+
+    return (float)m_answered / total;
+}
+
+
+int
+ResolverStats::latencyPercentile( int percentile ) const
+{
+    if ( m_latencies.isEmpty() )
+        return -1;
+
+    QList< int > sorted = m_latencies;
+    qSort( sorted );
+
+    const int i = qBound( 0, ( sorted.count() * percentile ) / 100, sorted.count() - 1 );
+    return sorted.at( i );
+}
+
+
+unsigned int
+ResolverStats::adaptiveTimeout( unsigned int configured ) const
+{
+    if ( !configured || m_latencies.count() < MIN_SAMPLES )
+        return configured;
+
+    // give it twice the time it takes for 95% of the answers, but never more than configured
+    const unsigned int timeout = qMax( MIN_TIMEOUT, latencyPercentile( 95 ) * 2 );
+    return qMin( timeout, configured );
+}
+
+
+QVariantMap
+ResolverStats::toVariant() const
+{
+    QVariantMap m;
+    m.insert( "inFlight", m_inFlight );
+    m.insert( "concurrencyLimit", concurrencyLimit() );
+    m.insert( "dispatched", m_dispatched );
+    m.insert( "answered", m_answered );
+    m.insert( "timedOut", m_timedOut );
+    m.insert( "hits", m_hits );
+    m.insert( "successRate", successRate() );
+    m.insert( "latencyP50", latencyPercentile( 50 ) );
+    m.insert( "latencyP95", latencyPercentile( 95 ) );
+
+    QVariantList buckets;
+    foreach ( int bound, latencyBuckets() )
+        buckets << bound;
+    m.insert( "latencyBuckets", buckets );
+
+    QVariantList latencies;
+    foreach ( unsigned int count, m_latencyHistogram )
+        latencies << count;
+    m.insert( "latencyHistogram", latencies );
+
+    QVariantList scores;
+    foreach ( unsigned int count, m_scoreHistogram )
+        scores << count;
+    m.insert( "scoreHistogram", scores );
+
+    return m;
+}
@@ -0,0 +1,89 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2026, agent <agent@local>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RESOLVERSTATS_H
+#define RESOLVERSTATS_H
+
+#include <QList>
+#include <QVariantMap>
+
+#include "DllMacro.h"
+
+namespace Tomahawk
+{
+
+/*
+    Keeps track of how a single resolver performs: latency percentiles over
+    the most recent answers, and how often it answers in time at all.
+
+    The concurrency limit follows AIMD: every answer in time grows it by
+    1 / limit, every timeout halves it.
+*/
+class DLLEXPORT ResolverStats
+{
+public:
+    ResolverStats();
+
+    void dispatched();
+    void answered( int latency, bool hasResults );
+    void timedOut();
+    void scored( float score );
+
+    unsigned int inFlight() const { return m_inFlight; }
+    unsigned int concurrencyLimit() const { return (unsigned int)m_limit; }
+    bool canDispatch() const { return m_inFlight < concurrencyLimit(); }
+
+    unsigned int dispatchCount() const { return m_dispatched; }
+    unsigned int answerCount() const { return m_answered; }
+    unsigned int timeoutCount() const { return m_timedOut; }
+    unsigned int hitCount() const { return m_hits; }
+
+    /// share of dispatched queries that got answered before timing out
+    float successRate() const;
+    /// in ms, -1 as long as there are no samples yet
+    int latencyPercentile( int percentile ) const;
+    /// the configured timeout, shortened once we know how fast the resolver usually answers
+    unsigned int adaptiveTimeout( unsigned int configured ) const;
+
+    /// answers per latency bucket, see latencyBuckets() for the upper bounds in ms
+    QList< unsigned int > latencyHistogram() const { return m_latencyHistogram; }
+    static QList< int > latencyBuckets();
+    /// results per score, in ten buckets of 0.1 each
+    QList< unsigned int > scoreHistogram() const { return m_scoreHistogram; }
+
+    QVariantMap toVariant() const;
+
+private:
+    unsigned int m_inFlight;
+    float m_limit;
+
+    unsigned int m_dispatched;
+    unsigned int m_answered;
+    unsigned int m_timedOut;
+    unsigned int m_hits;
+
+    QList< int > m_latencies;
+    int m_nextSample;
+
+    QList< unsigned int > m_latencyHistogram;
+    QList< unsigned int > m_scoreHistogram;
+};
+
+}; //ns
+
+#endif // RESOLVERSTATS_H
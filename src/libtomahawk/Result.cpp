@@ -22,6 +22,7 @@
 #include "Collection.h"
 #include "Source.h"
 #include "database/Database.h"
+#include "database/DatabaseImpl.h"
 #include "database/DatabaseCommand_Resolve.h"
 #include "database/DatabaseCommand_AllTracks.h"
 #include "database/DatabaseCommand_AddFiles.h"
@@ -238,6 +239,31 @@ void
 Result::setArtist( const Tomahawk::artist_ptr& artist )
 {
     m_artist = artist;
+    updateSortNames();
+}
+
+
+void
+Result::setTrack( const QString& track )
+{
+    m_track = track;
+    updateSortNames();
+}
+
+
+void
+Result::updateSortNames()
+{
+    m_trackSortname = DatabaseImpl::sortname( m_track );
+
+    // same as the sortname of "artist track", without normalizing everything again
+    const QString artistSortname = m_artist.isNull() ? QString() : DatabaseImpl::sortname( m_artist->name() );
+    if ( artistSortname.isEmpty() )
+        m_artistTrackSortname = m_trackSortname;
+    else if ( m_trackSortname.isEmpty() )
+        m_artistTrackSortname = artistSortname;
+    else
+        m_artistTrackSortname = artistSortname + " " + m_trackSortname;
 }
 
 
@@ -63,6 +63,9 @@ public:
     Tomahawk::album_ptr album() const;
     Tomahawk::artist_ptr composer() const;
     QString track() const { return m_track; }
+    /// normalized forms of the track title, and of artist name and title combined, for comparing
+    QString trackSortname() const { return m_trackSortname; }
+    QString artistTrackSortname() const { return m_artistTrackSortname; }
     QString url() const { return m_url; }
     QString mimetype() const { return m_mimetype; }
     QString friendlySource() const;
@@ -84,7 +87,7 @@ public:
     void setArtist( const Tomahawk::artist_ptr& artist );
     void setAlbum( const Tomahawk::album_ptr& album );
     void setComposer( const Tomahawk::artist_ptr& composer );
-    void setTrack( const QString& track ) { m_track = track; }
+    void setTrack( const QString& track );
     void setMimetype( const QString& mimetype ) { m_mimetype = mimetype; }
     void setDuration( unsigned int duration ) { m_duration = duration; }
     void setBitrate( unsigned int bitrate ) { m_bitrate = bitrate; }
@@ -117,6 +120,7 @@ private:
     explicit Result();
 
     void updateAttributes();
+    void updateSortNames();
 
     mutable RID m_rid;
     collection_ptr m_collection;
@@ -126,6 +130,8 @@ private:
     Tomahawk::album_ptr m_album;
     Tomahawk::artist_ptr m_composer;
     QString m_track;
+    QString m_trackSortname;
+    QString m_artistTrackSortname;
     QString m_url;
     QString m_mimetype;
     QString m_friendlySource;
@@ -27,7 +27,6 @@
 #include "database/DatabaseCommand_AddSource.h"
 #include "database/DatabaseCommand_CollectionStats.h"
 #include "database/DatabaseCommand_SourceOffline.h"
-#include "database/DatabaseCommand_UpdateSearchIndex.h"
 #include "database/Database.h"
 
 #include <QCoreApplication>
@@ -47,7 +46,7 @@ Source::Source( int id, const QString& username )
     , m_online( false )
     , m_username( username )
     , m_id( id )
-    , m_updateIndexWhenSynced( false )
+    , m_updateStatsWhenSynced( false )
     , m_avatarUpdated( true )
     , m_state( DBSyncConnection::UNKNOWN )
     , m_cc( 0 )
@@ -284,9 +283,9 @@ Source::scanningFinished( unsigned int files )
 
     m_textStatus = QString();
 
-    if ( m_updateIndexWhenSynced )
+    if ( m_updateStatsWhenSynced )
     {
-        m_updateIndexWhenSynced = false;
+        m_updateStatsWhenSynced = false;
         updateTracks();
     }
 
@@ -449,9 +448,9 @@ Source::executeCommands()
     }
     else
     {
-        if ( m_updateIndexWhenSynced )
+        if ( m_updateStatsWhenSynced )
         {
-            m_updateIndexWhenSynced = false;
+            m_updateStatsWhenSynced = false;
             updateTracks();
         }
 
@@ -490,22 +489,16 @@ Source::reportSocialAttributesChanged( DatabaseCommand_SocialAction* action )
 void
 Source::updateTracks()
 {
-    {
-        DatabaseCommand* cmd = new DatabaseCommand_UpdateSearchIndex();
-        Database::instance()->enqueue( QSharedPointer<DatabaseCommand>( cmd ) );
-    }
-
-    {
-        // Re-calculate local db stats
-        DatabaseCommand_CollectionStats* cmd = new DatabaseCommand_CollectionStats( SourceList::instance()->get( id() ) );
-        connect( cmd, SIGNAL( done( QVariantMap ) ), SLOT( setStats( QVariantMap ) ), Qt::QueuedConnection );
-        Database::instance()->enqueue( QSharedPointer<DatabaseCommand>( cmd ) );
-    }
+    // the search index is kept up to date by the commands changing the collection.
+    // Re-calculate local db stats
+    DatabaseCommand_CollectionStats* cmd = new DatabaseCommand_CollectionStats( SourceList::instance()->get( id() ) );
+    connect( cmd, SIGNAL( done( QVariantMap ) ), SLOT( setStats( QVariantMap ) ), Qt::QueuedConnection );
+    Database::instance()->enqueue( QSharedPointer<DatabaseCommand>( cmd ) );
 }
 
 
 void
-Source::updateIndexWhenSynced()
+Source::updateStatsWhenSynced()
 {
-    m_updateIndexWhenSynced = true;
+    m_updateStatsWhenSynced = true;
 }
@@ -118,7 +118,7 @@ public slots:
 private slots:
     void dbLoaded( unsigned int id, const QString& fname );
     QString lastCmdGuid() const { return m_lastCmdGuid; }
-    void updateIndexWhenSynced();
+    void updateStatsWhenSynced();
 
     void setOffline();
     void setOnline();
@@ -146,7 +146,7 @@ private:
     QString m_friendlyname;
     int m_id;
     bool m_scrubFriendlyName;
-    bool m_updateIndexWhenSynced;
+    bool m_updateStatsWhenSynced;
     bool m_avatarUpdated;
 
     Tomahawk::query_ptr m_currentTrack;
@@ -589,6 +589,16 @@ TomahawkSettings::doUpgrade( int oldVersion, int newVersion )
             createSpotifyAccount();
         }
     }
+    else if ( oldVersion == 12 )
+    {
+        // The search index now indexes track & album ids, so it can be updated incrementally. Force a reindex.
+        QTimer::singleShot( 0, this, SLOT( updateIndex() ) );
+    }
+    else if ( oldVersion == 13 )
+    {
+        // Artists and albums are indexed with their names now, for suggestions. Force a reindex.
+        QTimer::singleShot( 0, this, SLOT( updateIndex() ) );
+    }
 }
 
 
@@ -683,6 +693,48 @@ TomahawkSettings::setWatchForChanges( bool watch )
 }
 
 
+uint
+TomahawkSettings::resultRegistrySize() const
+{
+    return value( "pipeline/resultregistrysize", 20000 ).toUInt();
+}
+
+
+void
+TomahawkSettings::setResultRegistrySize( uint size )
+{
+    setValue( "pipeline/resultregistrysize", size );
+}
+
+
+uint
+TomahawkSettings::resultRegistryTimeout() const
+{
+    return value( "pipeline/resultregistrytimeout", 60 ).toUInt();
+}
+
+
+void
+TomahawkSettings::setResultRegistryTimeout( uint minutes )
+{
+    setValue( "pipeline/resultregistrytimeout", minutes );
+}
+
+
+bool
+TomahawkSettings::pipelineTracing() const
+{
+    return value( "pipeline/tracing", false ).toBool();
+}
+
+
+void
+TomahawkSettings::setPipelineTracing( bool enable )
+{
+    setValue( "pipeline/tracing", enable );
+}
+
+
 bool
 TomahawkSettings::httpEnabled() const
 {
@@ -28,7 +28,7 @@
 #include <QtNetwork/QNetworkProxy>
 #include <QStringList>
 
-#define TOMAHAWK_SETTINGS_VERSION 12
+#define TOMAHAWK_SETTINGS_VERSION 14
 
 /**
  * Convenience wrapper around QSettings for tomahawk-specific config
@@ -60,6 +60,15 @@ public:
     bool watchForChanges() const;
     void setWatchForChanges( bool watch );
 
+    /// how many resolved results the pipeline keeps track of, and for how many minutes after they were last used
+    uint resultRegistrySize() const;
+    void setResultRegistrySize( uint size );
+    uint resultRegistryTimeout() const;
+    void setResultRegistryTimeout( uint minutes );
+    /// record and dump how queries make their way through the pipeline
+    bool pipelineTracing() const;
+    void setPipelineTracing( bool enable );
+
     bool acceptedLegalWarning() const;
     void setAcceptedLegalWarning( bool accept );
 
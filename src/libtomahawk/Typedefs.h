@@ -86,6 +86,11 @@ namespace Tomahawk
         enum LatchMode { StayOnSong, RealTime };
     }
 
+    namespace ResolvePriority {
+        // lower values get resolved first
+        enum Priority { Playing = 0, Visible, Background };
+    }
+
 
     struct SerializedUpdater {
         QString type;
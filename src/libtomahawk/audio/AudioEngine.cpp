@@ -31,6 +31,7 @@
 #include "database/Database.h"
 #include "database/DatabaseCommand_LogPlayback.h"
 #include "network/Servent.h"
+#include "Pipeline.h"
 #include "utils/Qnr_IoDeviceStream.h"
 #include "utils/Closure.h"
 #include "HeadlessCheck.h"
@@ -42,6 +43,12 @@
 using namespace Tomahawk;
 
 #define AUDIO_VOLUME_STEP 5
+// how many of the upcoming tracks get resolved ahead of time
+#define PREFETCH_TRACKS 3
+// open the next track's stream once the current one has less time left than this (in seconds)
+#define WARM_UP_TIME 10
+// read this much of the next local file, so it's in the OS cache when we need it
+#define WARM_UP_BYTES ( 64 * 1024 )
 
 static QString s_aeInfoIdentifier = QString( "AUDIOENGINE" );
 
@@ -61,6 +68,7 @@ AudioEngine::AudioEngine()
     , m_timeElapsed( 0 )
     , m_expectStop( false )
     , m_waitingOnNewTrack( false )
+    , m_warmedUp( false )
     , m_state( Stopped )
 {
     s_instance = this;
@@ -172,6 +180,12 @@ AudioEngine::stop( AudioErrorCode errorCode )
     m_mediaObject->stop();
     emit stopped();
 
+    if ( !m_warmedInput.isNull() )
+        m_warmedInput->close();
+    m_warmedInput.clear();
+    m_warmedTrack.clear();
+    m_warmedUp = false;
+
     if ( !m_playlist.isNull() )
         m_playlist.data()->reset();
     if ( !m_currentTrack.isNull() )
@@ -419,6 +433,16 @@ AudioEngine::loadTrack( const Tomahawk::result_ptr& result )
     {
         QSharedPointer<QIODevice> io;
 
+        // we either use what we opened ahead of time now, or never will
+        QSharedPointer<QIODevice> warmedInput = m_warmedInput;
+        const bool warmedMatches = !result.isNull() && m_warmedTrack == result;
+        m_warmedInput.clear();
+        m_warmedTrack.clear();
+        m_warmedUp = false;
+
+        if ( !warmedMatches && !warmedInput.isNull() )
+            warmedInput->close();
+
         if ( result.isNull() )
             err = true;
         else
@@ -427,7 +451,10 @@ AudioEngine::loadTrack( const Tomahawk::result_ptr& result )
 
             if ( !isHttpResult( m_currentTrack->url() ) && !isLocalResult( m_currentTrack->url() ) )
             {
-                io = Servent::instance()->getIODeviceForUrl( m_currentTrack );
+                if ( warmedMatches && !warmedInput.isNull() )
+                    io = warmedInput;
+                else
+                    io = Servent::instance()->getIODeviceForUrl( m_currentTrack );
 
                 if ( !io || io.isNull() )
                 {
@@ -485,6 +512,8 @@ AudioEngine::loadTrack( const Tomahawk::result_ptr& result )
             queueState( Playing );
             emit started( m_currentTrack );
 
+            prefetchUpcoming();
+
             if ( TomahawkSettings::instance()->privateListeningMode() != TomahawkSettings::FullyPrivate )
             {
                 DatabaseCommand_LogPlayback* cmd = new DatabaseCommand_LogPlayback( m_currentTrack, DatabaseCommand_LogPlayback::Started );
@@ -607,6 +636,9 @@ AudioEngine::playItem( Tomahawk::playlistinterface_ptr playlist, const Tomahawk:
     {
         NewClosure( query.data(), SIGNAL( resolvingFinished( bool ) ),
                     const_cast<AudioEngine*>(this), SLOT( playItem( Tomahawk::playlistinterface_ptr, Tomahawk::query_ptr ) ), playlist, query );
+
+        // the user is waiting for this one, get it resolved first
+        Pipeline::instance()->resolve( query, Tomahawk::ResolvePriority::Playing );
     }
 }
 
@@ -645,6 +677,74 @@ AudioEngine::playItem( const Tomahawk::album_ptr& album )
 }
 
 
+QList< Tomahawk::query_ptr >
+AudioEngine::upcomingQueries() const
+{
+    // the queue always plays first, then the playlist continues
+    QList< query_ptr > queries;
+    if ( !m_queue.isNull() && m_queue->trackCount() )
+        queries << m_queue->upcomingQueries( PREFETCH_TRACKS );
+    if ( !m_playlist.isNull() && queries.count() < PREFETCH_TRACKS )
+        queries << m_playlist.data()->upcomingQueries( PREFETCH_TRACKS - queries.count() );
+
+    return queries;
+}
+
+
+void
+AudioEngine::prefetchUpcoming()
+{
+    const QList< query_ptr > queries = upcomingQueries();
+    for ( int i = 0; i < queries.count(); i++ )
+    {
+        const query_ptr& q = queries.at( i );
+        if ( q->resolvingFinished() )
+            continue;
+
+        // the very next one is as urgent as what we're playing right now
+        Pipeline::instance()->resolve( q, i == 0 ? ResolvePriority::Playing : ResolvePriority::Visible );
+    }
+}
+
+
+void
+AudioEngine::warmUpNextTrack()
+{
+    m_warmedUp = true;
+
+    result_ptr next;
+    foreach ( const query_ptr& q, upcomingQueries() )
+    {
+        if ( q->playable() )
+        {
+            next = q->results().first();
+            break;
+        }
+    }
+
+    // phonon deals with http urls itself
+    if ( next.isNull() || isHttpResult( next->url() ) )
+        return;
+
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << next->url();
+    QSharedPointer<QIODevice> io = Servent::instance()->getIODeviceForUrl( next );
+    if ( io.isNull() )
+        return;
+
+    if ( isLocalResult( next->url() ) )
+    {
+        // phonon opens local files by itself, just make sure the file is ready to be read
+        if ( io->isOpen() )
+            io->read( WARM_UP_BYTES );
+        io->close();
+        return;
+    }
+
+    m_warmedTrack = next;
+    m_warmedInput = io;
+}
+
+
 void
 AudioEngine::onPlaylistNextTrackReady()
 {
@@ -760,6 +860,9 @@ AudioEngine::timerTriggered( qint64 time )
             else
             {
                 emit timerPercentage( ( (double)m_timeElapsed / (double)m_currentTrack->duration() ) * 100.0 );
+
+                if ( !m_warmedUp && m_timeElapsed + WARM_UP_TIME >= m_currentTrack->duration() )
+                    warmUpNextTrack();
             }
         }
     }
@@ -793,6 +896,9 @@ AudioEngine::setPlaylist( Tomahawk::playlistinterface_ptr playlist )
         connect( m_playlist.data(), SIGNAL( nextTrackReady() ), SLOT( onPlaylistNextTrackReady() ) );
 
     emit playlistChanged( playlist );
+
+    // resolve what we're going to play next, as long as there is time to do so
+    QTimer::singleShot( 0, this, SLOT( prefetchUpcoming() ) );
 }
 
 
@@ -135,13 +135,17 @@ private slots:
     void setCurrentTrack( const Tomahawk::result_ptr& result );
     void onNowPlayingInfoReady( const Tomahawk::InfoSystem::InfoType type );
     void onPlaylistNextTrackReady();
+    void prefetchUpcoming();
 
     void sendNowPlayingNotification( const Tomahawk::InfoSystem::InfoType type );
     void sendWaitingNotification() const;
-    
+
     void queueStateSafety();
 
 private:
+    QList< Tomahawk::query_ptr > upcomingQueries() const;
+    void warmUpNextTrack();
+
     void checkStateQueue();
     void queueState( AudioState state );
 
@@ -151,6 +155,9 @@ private:
     bool isLocalResult( const QString& ) const;
 
     QSharedPointer<QIODevice> m_input;
+    // opened ahead of time for the track we expect to play next
+    QSharedPointer<QIODevice> m_warmedInput;
+    Tomahawk::result_ptr m_warmedTrack;
 
     Tomahawk::query_ptr m_stopAfterTrack;
     Tomahawk::result_ptr m_currentTrack;
@@ -164,6 +171,7 @@ private:
     unsigned int m_timeElapsed;
     bool m_expectStop;
     bool m_waitingOnNewTrack;
+    bool m_warmedUp;
 
     mutable QStringList m_supportedMimeTypes;
     unsigned int m_volume;
@@ -31,6 +31,30 @@
 Database* Database::s_instance = 0;
 
 
+// the connection of a thread, QThreadStorage deletes it on that thread when it exits
+class Database::ThreadImpl
+{
+public:
+    ThreadImpl( DatabaseImpl* impl, bool owned )
+        : impl( impl )
+        , owned( owned )
+    {}
+
+    ~ThreadImpl()
+    {
+        if ( owned )
+        {
+            tDebug() << Q_FUNC_INFO << "Closing database connection of thread" << QThread::currentThread();
+            delete impl;
+        }
+    }
+
+    DatabaseImpl* impl;
+    // workers close their connections themselves
+    bool owned;
+};
+
+
 Database*
 Database::instance()
 {
@@ -38,10 +62,10 @@ Database::instance()
 }
 
 
-Database::Database( const QString& dbname, QObject* parent )
+Database::Database( const QString& dbname, bool trigramIndex, QObject* parent )
     : QObject( parent )
     , m_ready( false )
-    , m_impl( new DatabaseImpl( dbname, this ) )
+    , m_impl( new DatabaseImpl( dbname, trigramIndex, this ) )
     , m_workerRW( new DatabaseWorker( m_impl, this, true ) )
 {
     s_instance = this;
@@ -63,6 +87,8 @@ Database::~Database()
 
     qDeleteAll( m_workers );
     delete m_workerRW;
+
+    // connections opened for other threads get closed when those exit
     delete m_impl;
 }
 
@@ -102,9 +128,11 @@ Database::enqueue( const QSharedPointer<DatabaseCommand>& lc )
             m_workers << worker;
         }
 
-        // find thread for commandname with lowest amount of outstanding jobs and enqueue job
+        // find thread where the fewest jobs would run before this one and enqueue job.
+        // Queued commands of a lower priority don't count, they get overtaken anyway
         int busyThreads = 0;
         DatabaseWorker* happyThread = 0;
+        unsigned int happyJobsAhead = 0;
         for ( int i = 0; i < m_workers.count(); i++ )
         {
             DatabaseWorker* worker = m_workers.at( i );
@@ -116,8 +144,12 @@ Database::enqueue( const QSharedPointer<DatabaseCommand>& lc )
             }
             busyThreads++;
 
-            if ( !happyThread || worker->outstandingJobs() < happyThread->outstandingJobs() )
+            const unsigned int jobsAhead = worker->jobsAhead( lc->priority() );
+            if ( !happyThread || jobsAhead < happyJobsAhead )
+            {
                 happyThread = worker;
+                happyJobsAhead = jobsAhead;
+            }
         }
 
 //        qDebug() << "Enqueueing command to thread:" << happyThread << busyThreads << lc->commandname();
@@ -126,6 +158,43 @@ Database::enqueue( const QSharedPointer<DatabaseCommand>& lc )
 }
 
 
+DatabaseImpl*
+Database::impl()
+{
+    QThread* thread = QThread::currentThread();
+    if ( thread == this->thread() )
+        return m_impl;
+
+    if ( m_threadImpls.hasLocalData() )
+        return m_threadImpls.localData()->impl;
+
+    tDebug() << Q_FUNC_INFO << "Opening database connection for thread" << thread;
+    DatabaseImpl* impl;
+    {
+        QMutexLocker lock( &m_implMutex );
+        impl = m_impl->clone( false );
+    }
+
+    // callers get no connection then, the next call tries again
+    if ( !impl )
+    {
+        tLog() << Q_FUNC_INFO << "Can't open a database connection for thread" << thread;
+        return 0;
+    }
+
+    m_threadImpls.setLocalData( new ThreadImpl( impl, true ) );
+    return impl;
+}
+
+
+void
+Database::setThreadImpl( DatabaseImpl* impl )
+{
+    // replacing the local data deletes the old one
+    m_threadImpls.setLocalData( impl ? new ThreadImpl( impl, false ) : 0 );
+}
+
+
 QString
 Database::dbid() const
 {
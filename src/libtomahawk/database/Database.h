@@ -22,6 +22,8 @@
 
 #include <QSharedPointer>
 #include <QVariant>
+#include <QMutex>
+#include <QThreadStorage>
 
 #include "Artist.h"
 #include "Album.h"
@@ -41,6 +43,10 @@ class DatabaseWorker;
     the queue of work. There is a threadpool responsible for exec'ing all
     the non-mutating (readonly) commands and one separate thread for mutating ones,
     so sqlite doesn't write to the Database from multiple threads.
+
+    Every thread talks to sqlite through a connection of its own (see impl()), the
+    read workers open theirs read-only. The database runs in WAL mode, so readers
+    don't have to wait for the writer to commit.
 */
 class DLLEXPORT Database : public QObject
 {
@@ -49,7 +55,8 @@ Q_OBJECT
 public:
     static Database* instance();
 
-    explicit Database( const QString& dbname, QObject* parent = 0 );
+    // trigramIndex: search with a TrigramIndex instead of Lucene
+    explicit Database( const QString& dbname, bool trigramIndex = false, QObject* parent = 0 );
     ~Database();
 
     QString dbid() const;
@@ -74,10 +81,17 @@ private slots:
     void setIsReadyTrue() { m_ready = true; }
 
 private:
-    DatabaseImpl* impl() const { return m_impl; }
+    class ThreadImpl;
+
+    // the DatabaseImpl to use from the calling thread. Threads without a worker's
+    // connection get their own read-write one on first use, it gets closed when the thread exits
+    DatabaseImpl* impl();
+    void setThreadImpl( DatabaseImpl* impl );
 
     bool m_ready;
     DatabaseImpl* m_impl;
+    QThreadStorage< ThreadImpl* > m_threadImpls;
+    QMutex m_implMutex;
     DatabaseWorker* m_workerRW;
     QList<DatabaseWorker*> m_workers;
     bool m_indexReady;
@@ -87,6 +101,10 @@ private:
 
     friend class Tomahawk::Artist;
     friend class Tomahawk::Album;
+    // update the search index from their postCommitHook()
+    friend class DatabaseCommand_AddFiles;
+    friend class DatabaseCommand_DeleteFiles;
+    friend class DatabaseWorker;
 };
 
 #endif // DATABASE_H
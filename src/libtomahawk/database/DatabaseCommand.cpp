@@ -38,6 +38,8 @@
 DatabaseCommand::DatabaseCommand( QObject* parent )
     : QObject( parent )
     , m_state( PENDING )
+    , m_priority( Interactive )
+    , m_canceled( 0 )
 {
     //qDebug() << Q_FUNC_INFO;
 }
@@ -46,6 +48,8 @@ DatabaseCommand::DatabaseCommand( QObject* parent )
 DatabaseCommand::DatabaseCommand( const source_ptr& src, QObject* parent )
     : QObject( parent )
     , m_state( PENDING )
+    , m_priority( Interactive )
+    , m_canceled( 0 )
     , m_source( src )
 {
     //qDebug() << Q_FUNC_INFO;
@@ -53,6 +57,8 @@ DatabaseCommand::DatabaseCommand( const source_ptr& src, QObject* parent )
 
 DatabaseCommand::DatabaseCommand( const DatabaseCommand& other )
     : QObject( other.parent() )
+    , m_priority( other.m_priority )
+    , m_canceled( 0 )
 {
 }
 
@@ -21,6 +21,7 @@
 #define DATABASECOMMAND_H
 
 #include <QObject>
+#include <QAtomicInt>
 #include <QMetaType>
 #include <QTime>
 #include <QSqlQuery>
@@ -45,6 +46,13 @@ public:
         FINISHED = 2
     };
 
+    // read-only commands with a lower value run first. Mutating commands keep their order, their priority has no effect
+    enum Priority {
+        Interactive = 0, // the user is waiting for this
+        Resolve = 1,
+        Background = 2
+    };
+
     explicit DatabaseCommand( QObject* parent = 0 );
     explicit DatabaseCommand( const Tomahawk::source_ptr& src, QObject* parent = 0 );
 
@@ -56,6 +64,13 @@ public:
     virtual bool doesMutates() const { return true; }
     State state() const { return m_state; }
 
+    Priority priority() const { return m_priority; }
+    void setPriority( Priority priority ) { m_priority = priority; }
+
+    // a canceled command that is still queued doesn't run at all. finished() is emitted nevertheless
+    void cancel() { m_canceled = 1; }
+    bool isCanceled() const { return m_canceled != 0; }
+
     // if i make this pure virtual, i get compile errors in qmetatype.h.
     // we need Q_DECLARE_METATYPE to use in queued sig/slot connections.
     virtual void exec( DatabaseImpl* /*lib*/ ) { Q_ASSERT( false ); }
@@ -98,6 +113,8 @@ signals:
 
 private:
     State m_state;
+    Priority m_priority;
+    QAtomicInt m_canceled;
     Tomahawk::source_ptr m_source;
     mutable QString m_guid;
 
@@ -19,6 +19,8 @@
 #include "DatabaseCommand_AddFiles.h"
 
 #include <QSqlQuery>
+#include <QSet>
+#include <QTime>
 
 #include "Artist.h"
 #include "Album.h"
@@ -33,6 +35,19 @@
 
 using namespace Tomahawk;
 
+// how many files an import needs before rebuilding some indexes beats updating them
+#define DEFERRED_INDEX_THRESHOLD 10000
+
+// keep in sync with Schema.sql
+static const char* s_deferredIndexes[] = {
+    "file_join_track ON file_join(track)",
+    "file_join_artist ON file_join(artist)",
+    "file_join_album ON file_join(album)",
+    "track_attrib_id ON track_attributes(id)",
+    "track_attrib_k ON track_attributes(k)",
+    0
+};
+
 
 // remove file paths when making oplog/for network transmission
 QVariantList
@@ -55,6 +70,16 @@ DatabaseCommand_AddFiles::files() const
 void
 DatabaseCommand_AddFiles::postCommitHook()
 {
+    // only the tracks, albums and artists of these files get (re-)indexed, instead of rebuilding the whole index.
+    // Not before the commit, a search must not find what a rollback would take back
+    DatabaseImpl* dbi = Database::instance()->impl();
+    dbi->updateSearchIndex( m_indexTracks );
+    dbi->updateSearchIndex( m_indexAlbums );
+    dbi->updateSearchIndex( m_indexArtists );
+    m_indexTracks.clear();
+    m_indexAlbums.clear();
+    m_indexArtists.clear();
+
     // make the collection object emit its tracksAdded signal, so the
     // collection browser will update/fade in etc.
     Collection* coll = source()->collection().data();
@@ -69,103 +94,205 @@ DatabaseCommand_AddFiles::postCommitHook()
 }
 
 
+DatabaseCommand_AddFiles::FileEntry
+DatabaseCommand_AddFiles::fileEntry( const QVariantMap& m )
+{
+    FileEntry entry;
+    entry.url        = m.value( "url" ).toString();
+    entry.mtime      = m.value( "mtime" ).toInt();
+    entry.size       = m.value( "size" ).toUInt();
+    entry.hash       = m.value( "hash" ).toString();
+    entry.mimetype   = m.value( "mimetype" ).toString();
+    entry.duration   = m.value( "duration" ).toUInt();
+    entry.bitrate    = m.value( "bitrate" ).toUInt();
+    entry.artist     = m.value( "artist" ).toString();
+    entry.album      = m.value( "album" ).toString();
+    entry.track      = m.value( "track" ).toString();
+    entry.albumpos   = m.value( "albumpos" ).toUInt();
+    entry.composer   = m.value( "composer" ).toString();
+    entry.discnumber = m.value( "discnumber" ).toUInt();
+    entry.year       = m.value( "year" ).toInt();
+
+    return entry;
+}
+
+
+static int
+nextFileId( DatabaseImpl* dbi )
+{
+    // file ids are AUTOINCREMENT, ids of deleted files must not be handed out again
+    TomahawkSqlQuery query = dbi->newquery();
+    query.exec( "SELECT MAX( COALESCE( ( SELECT seq FROM sqlite_sequence WHERE name = 'file' ), 0 ), "
+                "COALESCE( ( SELECT MAX(id) FROM file ), 0 ) )" );
+
+    if ( query.next() )
+        return query.value( 0 ).toInt() + 1;
+
+    return 1;
+}
+
+
+// big imports into a small collection are faster when these indexes get built once
+// afterwards, instead of being updated for every row
+static bool
+shouldDeferIndexes( DatabaseImpl* dbi, int files )
+{
+    if ( files < DEFERRED_INDEX_THRESHOLD )
+        return false;
+
+    TomahawkSqlQuery query = dbi->newquery();
+    query.exec( "SELECT COUNT(*) FROM file_join" );
+
+    return query.next() && query.value( 0 ).toInt() < files;
+}
+
+
 void
 DatabaseCommand_AddFiles::exec( DatabaseImpl* dbi )
 {
     qDebug() << Q_FUNC_INFO;
     Q_ASSERT( !source().isNull() );
 
-    TomahawkSqlQuery query_file = dbi->newquery();
-    TomahawkSqlQuery query_filejoin = dbi->newquery();
-    TomahawkSqlQuery query_trackattr = dbi->newquery();
+    QTime timer;
+    timer.start();
 
-    query_file.prepare( "INSERT INTO file(source, url, size, mtime, md5, mimetype, duration, bitrate) VALUES (?, ?, ?, ?, ?, ?, ?, ?)" );
-    query_filejoin.prepare( "INSERT INTO file_join(file, artist, album, track, albumpos, composer, discnumber) VALUES (?, ?, ?, ?, ?, ?, ?)" );
-    query_trackattr.prepare( "INSERT INTO track_attributes(id, k, v) VALUES (?, ?, ?)" );
-
-    int added = 0;
     QVariant srcid = source()->isLocal() ? QVariant( QVariant::Int ) : source()->id();
     qDebug() << "Adding" << m_files.length() << "files to db for source" << srcid;
 
-    QList<QVariant>::iterator it;
-    for ( it = m_files.begin(); it != m_files.end(); ++it )
+    QList< FileEntry > entries;
+    QStringList artistNames;
+    foreach ( const QVariant& v, m_files )
     {
-        QVariant& v = *it;
-        QVariantMap m = v.toMap();
+        const FileEntry entry = fileEntry( v.toMap() );
+        entries << entry;
+
+        artistNames << entry.artist;
+        if ( !entry.composer.trimmed().isEmpty() )
+            artistNames << entry.composer;
+    }
+
+    // resolve the ids of all artists, tracks and albums up front. Every name only gets
+    // looked up once, and the ones we don't know yet are inserted in bulk
+    const QHash< QString, int > artistIds = dbi->artistIds( artistNames, true );
+
+    QList< QPair<int, QString> > trackNames, albumNames;
+    foreach ( const FileEntry& entry, entries )
+    {
+        const int artistid = artistIds.value( entry.artist );
+        if ( artistid < 1 )
+            continue;
+
+        trackNames << qMakePair( artistid, entry.track );
+        albumNames << qMakePair( artistid, entry.album );
+    }
+    const QHash< QPair<int, QString>, int > trackIds = dbi->trackIds( trackNames, true );
+    const QHash< QPair<int, QString>, int > albumIds = dbi->albumIds( albumNames, true );
+    tDebug( LOGVERBOSE ) << "Resolved ids for" << entries.count() << "files:" << timer.elapsed() << "ms";
+
+    const bool deferIndexes = shouldDeferIndexes( dbi, entries.count() );
+    if ( deferIndexes )
+    {
+        TomahawkSqlQuery indexQuery = dbi->newquery();
+        for ( int i = 0; s_deferredIndexes[i]; i++ )
+            indexQuery.exec( QString( "DROP INDEX IF EXISTS %1" ).arg( QString( s_deferredIndexes[i] ).section( ' ', 0, 0 ) ) );
+    }
+
+    // the files get consecutive ids, so we don't need to ask for the id of every single one.
+    // Files that are already known are ignored, and their ids stay unused
+    const int firstId = nextFileId( dbi );
+    QVariantList fileValues;
+    for ( int i = 0; i < entries.count(); i++ )
+    {
+        const FileEntry& entry = entries.at( i );
+        fileValues << firstId + i << srcid << entry.url << entry.size << entry.mtime
+                   << entry.hash << entry.mimetype << entry.duration << entry.bitrate;
+    }
+
+    if ( !dbi->insertRows( "INSERT OR IGNORE INTO file(id, source, url, size, mtime, md5, mimetype, duration, bitrate)", 9, fileValues ) )
+        throw "Failed to insert files";
+
+    QSet< int > inserted;
+    TomahawkSqlQuery query = dbi->newquery();
+    query.prepare( "SELECT id FROM file WHERE id >= ? AND id < ?" );
+    query.addBindValue( firstId );
+    query.addBindValue( firstId + entries.count() );
+    query.exec();
+    while ( query.next() )
+        inserted << query.value( 0 ).toInt();
+
+    int added = 0;
+    QVariantList joinValues, attributeValues;
+    for ( int i = 0; i < entries.count(); i++ )
+    {
+        const FileEntry& entry = entries.at( i );
+        const int fileid = firstId + i;
+        if ( !inserted.contains( fileid ) )
+        {
+            qDebug() << "Skipping file that is already in the database:" << entry.url;
+            continue;
+        }
 
-        int fileid = 0, artistid = 0, albumid = 0, trackid = 0, composerid = 0;
-
-        QString url      = m.value( "url" ).toString();
-        int mtime        = m.value( "mtime" ).toInt();
-        uint size        = m.value( "size" ).toUInt();
-        QString hash     = m.value( "hash" ).toString();
-        QString mimetype = m.value( "mimetype" ).toString();
-        uint duration    = m.value( "duration" ).toUInt();
-        uint bitrate     = m.value( "bitrate" ).toUInt();
-        QString artist   = m.value( "artist" ).toString();
-        QString album    = m.value( "album" ).toString();
-        QString track    = m.value( "track" ).toString();
-        uint albumpos    = m.value( "albumpos" ).toUInt();
-        QString composer = m.value( "composer" ).toString();
-        uint discnumber  = m.value( "discnumber" ).toUInt();
-        int year         = m.value( "year" ).toInt();
-
-        query_file.bindValue( 0, srcid );
-        query_file.bindValue( 1, url );
-        query_file.bindValue( 2, size );
-        query_file.bindValue( 3, mtime );
-        query_file.bindValue( 4, hash );
-        query_file.bindValue( 5, mimetype );
-        query_file.bindValue( 6, duration );
-        query_file.bindValue( 7, bitrate );
-        query_file.exec();
-
-        if ( added % 1000 == 0 )
-            qDebug() << "Inserted" << added;
-
-        // get internal IDs for art/alb/trk
-        fileid = query_file.lastInsertId().toInt();
-        m.insert( "id", fileid );
         // this is the qvariant(map) the remote will get
-        v = m;
+        QVariantMap m = m_files.at( i ).toMap();
+        m.insert( "id", fileid );
+        m_files[i] = m;
 
-        artistid = dbi->artistId( artist, true );
+        const int artistid = artistIds.value( entry.artist );
         if ( artistid < 1 )
             continue;
-        trackid = dbi->trackId( artistid, track, true );
+        const int trackid = trackIds.value( qMakePair( artistid, entry.track ) );
         if ( trackid < 1 )
             continue;
-        albumid = dbi->albumId( artistid, album, true );
-
-        if( !composer.trimmed().isEmpty() )
-            composerid = dbi->artistId( composer, true );
+        const int albumid = albumIds.value( qMakePair( artistid, entry.album ) );
+        const int composerid = entry.composer.trimmed().isEmpty() ? 0 : artistIds.value( entry.composer );
 
         // Now add the association
-        query_filejoin.bindValue( 0, fileid );
-        query_filejoin.bindValue( 1, artistid );
-        query_filejoin.bindValue( 2, albumid > 0 ? albumid : QVariant( QVariant::Int ) );
-        query_filejoin.bindValue( 3, trackid );
-        query_filejoin.bindValue( 4, albumpos );
-        query_filejoin.bindValue( 5, composerid > 0 ? composerid : QVariant( QVariant::Int ) );
-        query_filejoin.bindValue( 6, discnumber );
-        if ( !query_filejoin.exec() )
+        joinValues << fileid << artistid
+                   << ( albumid > 0 ? QVariant( albumid ) : QVariant( QVariant::Int ) )
+                   << trackid << entry.albumpos
+                   << ( composerid > 0 ? QVariant( composerid ) : QVariant( QVariant::Int ) )
+                   << entry.discnumber;
+
+        attributeValues << trackid << "releaseyear" << entry.year;
+
+        QMap< QString, QString > track;
+        track.insert( "track", entry.track );
+        track.insert( "artist", entry.artist );
+        m_indexTracks.insert( trackid, track );
+
+        QMap< QString, QString > artist;
+        artist.insert( "artist", entry.artist );
+        m_indexArtists.insert( artistid, artist );
+
+        if ( albumid > 0 )
         {
-            qDebug() << "Error inserting into file_join table";
-            continue;
+            QMap< QString, QString > album;
+            album.insert( "album", entry.album );
+            album.insert( "artistid", QString::number( artistid ) );
+            album.insert( "artist", entry.artist );
+            m_indexAlbums.insert( albumid, album );
         }
 
-        query_trackattr.bindValue( 0, trackid );
-        query_trackattr.bindValue( 1, "releaseyear" );
-        query_trackattr.bindValue( 2, year );
-        query_trackattr.exec();
-
         m_ids << fileid;
         added++;
     }
-    qDebug() << "Inserted" << added << "tracks to database";
+
+    if ( !dbi->insertRows( "INSERT INTO file_join(file, artist, album, track, albumpos, composer, discnumber)", 7, joinValues ) )
+        throw "Failed to insert into file_join";
+
+    dbi->insertRows( "INSERT INTO track_attributes(id, k, v)", 3, attributeValues );
+
+    if ( deferIndexes )
+    {
+        TomahawkSqlQuery indexQuery = dbi->newquery();
+        for ( int i = 0; s_deferredIndexes[i]; i++ )
+            indexQuery.exec( QString( "CREATE INDEX IF NOT EXISTS %1" ).arg( s_deferredIndexes[i] ) );
+    }
+
+    qDebug() << "Inserted" << added << "tracks to database in" << timer.elapsed() << "ms";
 
     if ( added )
-        source()->updateIndexWhenSynced();
+        source()->updateStatsWhenSynced();
 
     tDebug() << "Committing" << added << "tracks...";
     emit done( m_files, source()->collection() );
@@ -58,8 +58,34 @@ signals:
     void notify( const QList<unsigned int>& ids );
 
 private:
+    // the fields of a file in m_files
+    struct FileEntry
+    {
+        QString url;
+        int mtime;
+        uint size;
+        QString hash;
+        QString mimetype;
+        uint duration;
+        uint bitrate;
+        QString artist;
+        QString album;
+        QString track;
+        uint albumpos;
+        QString composer;
+        uint discnumber;
+        int year;
+    };
+
+    static FileEntry fileEntry( const QVariantMap& m );
+
     QVariantList m_files;
     QList<unsigned int> m_ids;
+
+    // (re-)indexed once the files are committed, by track, album and artist id
+    QMap< unsigned int, QMap< QString, QString > > m_indexTracks;
+    QMap< unsigned int, QMap< QString, QString > > m_indexAlbums;
+    QMap< unsigned int, QMap< QString, QString > > m_indexArtists;
 };
 
 #endif // DATABASECOMMAND_ADDFILES_H
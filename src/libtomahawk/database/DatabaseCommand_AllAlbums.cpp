@@ -34,7 +34,10 @@ DatabaseCommand_AllAlbums::DatabaseCommand_AllAlbums( const Tomahawk::collection
   , m_amount( 0 )
   , m_sortOrder( DatabaseCommand_AllAlbums::None )
   , m_sortDescending( false )
-{}
+{
+    // loads whole collections, let resolving and whatever the user is waiting for go first
+    setPriority( DatabaseCommand::Background );
+}
 
 
 DatabaseCommand_AllAlbums::~DatabaseCommand_AllAlbums()
@@ -32,7 +32,10 @@ DatabaseCommand_AllArtists::DatabaseCommand_AllArtists( const Tomahawk::collecti
     , m_amount( 0 )
     , m_sortOrder( DatabaseCommand_AllArtists::None )
     , m_sortDescending( false )
-{}
+{
+    // loads whole collections, let resolving and whatever the user is waiting for go first
+    setPriority( DatabaseCommand::Background );
+}
 
 DatabaseCommand_AllArtists::~DatabaseCommand_AllArtists()
 {
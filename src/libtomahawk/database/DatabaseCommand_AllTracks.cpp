@@ -28,12 +28,54 @@
 #include "utils/Logger.h"
 
 
+// orders an index can serve: file.id itself, or file_mtime, which has file.id as its tie-breaker.
+// Continuing after the last row of a batch is cheap for these, other orders would get sorted again for every batch
+static bool
+isKeysetPageable( DatabaseCommand_AllTracks::SortOrder order )
+{
+    return order == DatabaseCommand_AllTracks::None || order == DatabaseCommand_AllTracks::ModificationTime;
+}
+
+
+static QString
+keysetOrder( DatabaseCommand_AllTracks::SortOrder order, bool descending )
+{
+    const QString direction = descending ? "DESC" : "ASC";
+    if ( order == DatabaseCommand_AllTracks::ModificationTime )
+        return QString( "ORDER BY file.mtime %1, file.id %1" ).arg( direction );
+
+    return QString( "ORDER BY file.id %1" ).arg( direction );
+}
+
+
+// the values of the keys a batch continues after, for the current row
+static QVariantList
+keysetValues( DatabaseCommand_AllTracks::SortOrder order, const TomahawkSqlQuery& query )
+{
+    QVariantList values;
+    if ( order == DatabaseCommand_AllTracks::ModificationTime )
+        values << query.value( 10 ).toUInt();
+
+    return values << query.value( 0 ).toUInt();
+}
+
+
+// matches all rows sorted after the row with the given keys. The range on mtime on its own
+// lets the index seek right to the start of the batch
+static QString
+keysetCondition( DatabaseCommand_AllTracks::SortOrder order, bool descending )
+{
+    const QString op = descending ? "<" : ">";
+    if ( order == DatabaseCommand_AllTracks::ModificationTime )
+        return QString( "AND file.mtime %1= ? AND ( file.mtime %1 ? OR file.id %1 ? )" ).arg( op );
+
+    return QString( "AND file.id %1 ?" ).arg( op );
+}
+
+
 void
 DatabaseCommand_AllTracks::exec( DatabaseImpl* dbi )
 {
-    TomahawkSqlQuery query = dbi->newquery();
-    QList<Tomahawk::query_ptr> ql;
-
     QString m_orderToken, sourceToken;
     switch ( m_sortOrder )
     {
@@ -54,7 +96,7 @@ DatabaseCommand_AllTracks::exec( DatabaseImpl* dbi )
     }
 
     if ( !m_collection.isNull() )
-        sourceToken = QString( "AND file.source %1" ).arg( m_collection->source()->isLocal() ? "IS NULL" : QString( "= %1" ).arg( m_collection->source()->id() ) );
+        sourceToken = QString( "AND file.source %1" ).arg( m_collection->source()->isLocal() ? "IS NULL" : "= ?" );
 
     QString albumToken;
     if ( m_album )
@@ -65,104 +107,151 @@ DatabaseCommand_AllTracks::exec( DatabaseImpl* dbi )
             albumToken = QString( "AND album.id IS NULL" );
         }
         else
-            albumToken = QString( "AND album.id = %1" ).arg( m_album->id() );
+            albumToken = QString( "AND album.id = ?" );
     }
 
-    QString sql = QString(
-            "SELECT file.id, artist.name, album.name, track.name, composer.name, file.size, "   //0
-                   "file.duration, file.bitrate, file.url, file.source, file.mtime, "           //6
-                   "file.mimetype, file_join.discnumber, file_join.albumpos, artist.id, "       //11
-                   "album.id, track.id, composer.id "                                           //15
-            "FROM file, artist, track, file_join "
-            "LEFT OUTER JOIN album "
-            "ON file_join.album = album.id "
-            "LEFT OUTER JOIN artist AS composer "
-            "ON file_join.composer = composer.id "
-            "WHERE file.id = file_join.file "
-            "AND file_join.artist = artist.id "
-            "AND file_join.track = track.id "
-            "%1 "
-            "%2 %3 "
-            "%4 %5 %6"
-            ).arg( sourceToken )
-             .arg( !m_artist ? QString() : QString( "AND artist.id = %1" ).arg( m_artist->id() ) )
-             .arg( !m_album ? QString() : albumToken )
-             .arg( m_sortOrder > 0 ? QString( "ORDER BY %1" ).arg( m_orderToken ) : QString() )
-             .arg( m_sortDescending ? "DESC" : QString() )
-             .arg( m_amount > 0 ? QString( "LIMIT 0, %1" ).arg( m_amount ) : QString() );
-
-    query.prepare( sql );
-    query.exec();
-
-    while( query.next() )
+    // when paging in an order an index can serve, every batch is a query of its own, continuing after
+    // the last row of the previous one. Other orders get sorted once, and the batches split up while reading
+    const bool paged = ( m_batchSize > 0 );
+    const bool keyset = paged && isKeysetPageable( m_sortOrder );
+    QString orderToken = m_sortOrder > 0 ? QString( "ORDER BY %1 %2" ).arg( m_orderToken ).arg( m_sortDescending ? "DESC" : QString() ) : QString();
+    if ( keyset )
+        orderToken = keysetOrder( m_sortOrder, m_sortDescending );
+
+    QVariantList lastKey;
+    unsigned int fetched = 0;
+    bool emitted = false;
+    while ( true )
     {
-        Tomahawk::source_ptr s;
-        QString url = query.value( 8 ).toString();
+        unsigned int limit = m_amount;
+        if ( keyset )
+            limit = ( m_amount > 0 ? qMin( m_batchSize, m_amount - fetched ) : m_batchSize );
 
-        if ( query.value( 9 ).toUInt() == 0 )
-        {
-            s = SourceList::instance()->getLocal();
-        }
-        else
+        QString sql = QString(
+                "SELECT file.id, artist.name, album.name, track.name, composer.name, file.size, "   //0
+                       "file.duration, file.bitrate, file.url, file.source, file.mtime, "           //6
+                       "file.mimetype, file_join.discnumber, file_join.albumpos, artist.id, "       //11
+                       "album.id, track.id, composer.id "                                           //15
+                "FROM file, artist, track, file_join "
+                "LEFT OUTER JOIN album "
+                "ON file_join.album = album.id "
+                "LEFT OUTER JOIN artist AS composer "
+                "ON file_join.composer = composer.id "
+                "WHERE file.id = file_join.file "
+                "AND file_join.artist = artist.id "
+                "AND file_join.track = track.id "
+                "%1 "
+                "%2 %3 %4 "
+                "%5 %6"
+                ).arg( sourceToken )
+                 .arg( !m_artist ? QString() : "AND artist.id = ?" )
+                 .arg( !m_album ? QString() : albumToken )
+                 .arg( lastKey.isEmpty() ? QString() : keysetCondition( m_sortOrder, m_sortDescending ) )
+                 .arg( orderToken )
+                 .arg( limit > 0 ? "LIMIT 0, ?" : QString() );
+
+        TomahawkSqlQuery query = dbi->newquery();
+        query.prepare( sql );
+        if ( !m_collection.isNull() && !m_collection->source()->isLocal() )
+            query.addBindValue( m_collection->source()->id() );
+        if ( m_artist )
+            query.addBindValue( m_artist->id() );
+        if ( m_album && m_album->id() != 0 )
+            query.addBindValue( m_album->id() );
+        if ( lastKey.count() > 1 )
+            query.addBindValue( lastKey.first() );
+        foreach ( const QVariant& value, lastKey )
+            query.addBindValue( value );
+        if ( limit > 0 )
+            query.addBindValue( limit );
+        query.exec();
+
+        QList<Tomahawk::query_ptr> ql;
+        QList< Tomahawk::result_ptr > allResults;
+        unsigned int rows = 0;
+        while( query.next() )
         {
-            s = SourceList::instance()->get( query.value( 9 ).toUInt() );
-            if ( s.isNull() )
+            rows++;
+            if ( keyset )
+                lastKey = keysetValues( m_sortOrder, query );
+
+            Tomahawk::source_ptr s;
+            QString url = query.value( 8 ).toString();
+
+            if ( query.value( 9 ).toUInt() == 0 )
             {
-                Q_ASSERT( false );
-                continue;
+                s = SourceList::instance()->getLocal();
             }
+            else
+            {
+                s = SourceList::instance()->get( query.value( 9 ).toUInt() );
+                if ( s.isNull() )
+                {
+                    Q_ASSERT( false );
+                    continue;
+                }
 
-            url = QString( "servent://%1\t%2" ).arg( s->userName() ).arg( url );
-        }
+                url = QString( "servent://%1\t%2" ).arg( s->userName() ).arg( url );
+            }
 
-        QString artist, track, album, composer;
-        artist = query.value( 1 ).toString();
-        album = query.value( 2 ).toString();
-        track = query.value( 3 ).toString();
-        composer = query.value( 4 ).toString();
-
-        Tomahawk::result_ptr result = Tomahawk::Result::get( url );
-        Tomahawk::query_ptr qry = Tomahawk::Query::get( artist, track, album );
-        Tomahawk::artist_ptr artistptr = Tomahawk::Artist::get( query.value( 14 ).toUInt(), artist );
-        Tomahawk::artist_ptr composerptr = Tomahawk::Artist::get( query.value( 17 ).toUInt(), composer );
-        Tomahawk::album_ptr albumptr = Tomahawk::Album::get( query.value( 15 ).toUInt(), album, artistptr );
-
-        result->setTrackId( query.value( 16 ).toUInt() );
-        result->setArtist( artistptr );
-        result->setAlbum( albumptr );
-        result->setTrack( query.value( 3 ).toString() );
-        result->setComposer( composerptr );
-        result->setSize( query.value( 5 ).toUInt() );
-        result->setDuration( query.value( 6 ).toUInt() );
-        result->setBitrate( query.value( 7 ).toUInt() );
-        result->setModificationTime( query.value( 10 ).toUInt() );
-        result->setMimetype( query.value( 11 ).toString() );
-        result->setDiscNumber( query.value( 12 ).toUInt() );
-        result->setAlbumPos( query.value( 13 ).toUInt() );
-        result->setScore( 1.0 );
-        result->setCollection( s->collection() );
-
-        TomahawkSqlQuery attrQuery = dbi->newquery();
-        QVariantMap attr;
-
-        attrQuery.prepare( "SELECT k, v FROM track_attributes WHERE id = ?" );
-        attrQuery.bindValue( 0, result->trackId() );
-        attrQuery.exec();
-        while ( attrQuery.next() )
-        {
-            attr[ attrQuery.value( 0 ).toString() ] = attrQuery.value( 1 ).toString();
+            QString artist, track, album, composer;
+            artist = query.value( 1 ).toString();
+            album = query.value( 2 ).toString();
+            track = query.value( 3 ).toString();
+            composer = query.value( 4 ).toString();
+
+            Tomahawk::result_ptr result = Tomahawk::Result::get( url );
+            Tomahawk::query_ptr qry = Tomahawk::Query::get( artist, track, album );
+            Tomahawk::artist_ptr artistptr = Tomahawk::Artist::get( query.value( 14 ).toUInt(), artist );
+            Tomahawk::artist_ptr composerptr = Tomahawk::Artist::get( query.value( 17 ).toUInt(), composer );
+            Tomahawk::album_ptr albumptr = Tomahawk::Album::get( query.value( 15 ).toUInt(), album, artistptr );
+
+            result->setTrackId( query.value( 16 ).toUInt() );
+            result->setArtist( artistptr );
+            result->setAlbum( albumptr );
+            result->setTrack( query.value( 3 ).toString() );
+            result->setComposer( composerptr );
+            result->setSize( query.value( 5 ).toUInt() );
+            result->setDuration( query.value( 6 ).toUInt() );
+            result->setBitrate( query.value( 7 ).toUInt() );
+            result->setModificationTime( query.value( 10 ).toUInt() );
+            result->setMimetype( query.value( 11 ).toString() );
+            result->setDiscNumber( query.value( 12 ).toUInt() );
+            result->setAlbumPos( query.value( 13 ).toUInt() );
+            result->setScore( 1.0 );
+            result->setCollection( s->collection() );
+
+            allResults << result;
+
+            QList<Tomahawk::result_ptr> results;
+            results << result;
+            qry->addResults( results );
+            qry->setResolveFinished( true );
+
+            ql << qry;
+
+            if ( paged && !keyset && ql.count() >= (int)m_batchSize )
+            {
+                dbi->loadTrackAttributes( allResults );
+                emit tracks( ql, data() );
+                emitted = true;
+
+                ql.clear();
+                allResults.clear();
+            }
         }
 
-        result->setAttributes( attr );
+        dbi->loadTrackAttributes( allResults );
+        fetched += rows;
 
-        QList<Tomahawk::result_ptr> results;
-        results << result;
-        qry->addResults( results );
-        qry->setResolveFinished( true );
+        // listeners expect at least one, possibly empty, batch
+        if ( !ql.isEmpty() || !emitted )
+            emit tracks( ql, data() );
+        emitted = true;
 
-        ql << qry;
+        if ( !keyset || rows < limit || ( m_amount > 0 && fetched >= m_amount ) )
+            break;
     }
 
-    emit tracks( ql, data() );
     emit done( m_collection );
 }
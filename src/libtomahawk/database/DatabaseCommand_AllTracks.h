@@ -48,9 +48,13 @@ public:
         , m_artist( 0 )
         , m_album( 0 )
         , m_amount( 0 )
+        , m_batchSize( 0 )
         , m_sortOrder( DatabaseCommand_AllTracks::None )
         , m_sortDescending( false )
-    {}
+    {
+        // loads whole collections, let resolving and whatever the user is waiting for go first
+        setPriority( DatabaseCommand::Background );
+    }
 
     virtual void exec( DatabaseImpl* );
 
@@ -61,6 +65,8 @@ public:
     void setAlbum( const Tomahawk::album_ptr& album ) { m_album = album; }
 
     void setLimit( unsigned int amount ) { m_amount = amount; }
+    // emits tracks() for every batch of this many tracks, instead of once for all of them
+    void setBatchSize( unsigned int size ) { m_batchSize = size; }
     void setSortOrder( DatabaseCommand_AllTracks::SortOrder order ) { m_sortOrder = order; }
     void setSortDescending( bool descending ) { m_sortDescending = descending; }
 
@@ -75,6 +81,7 @@ private:
     Tomahawk::album_ptr m_album;
 
     unsigned int m_amount;
+    unsigned int m_batchSize;
     DatabaseCommand_AllTracks::SortOrder m_sortOrder;
     bool m_sortDescending;
 };
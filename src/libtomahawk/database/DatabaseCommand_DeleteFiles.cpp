@@ -20,6 +20,7 @@
 #include "DatabaseCommand_DeleteFiles.h"
 
 #include <QtSql/QSqlQuery>
+#include <QtCore/QSet>
 
 #include "Artist.h"
 #include "Album.h"
@@ -31,6 +32,9 @@
 #include "utils/Logger.h"
 #include "utils/TomahawkUtils.h"
 
+// ids per IN ( ... ) list when looking up the tracks and albums of deleted files
+#define ID_BATCH 500
+
 using namespace Tomahawk;
 
 
@@ -38,6 +42,12 @@ using namespace Tomahawk;
 void
 DatabaseCommand_DeleteFiles::postCommitHook()
 {
+    // not before the commit, a rollback would leave the files without their documents
+    Database::instance()->impl()->removeFromSearchIndex( m_orphanedTracks, m_orphanedAlbums, m_orphanedArtists );
+    m_orphanedTracks.clear();
+    m_orphanedAlbums.clear();
+    m_orphanedArtists.clear();
+
     if ( !m_idList.count() )
         return;
 
@@ -56,6 +66,52 @@ DatabaseCommand_DeleteFiles::postCommitHook()
 }
 
 
+// collects the tracks, albums & artists of the given files, they may have to go from the search index
+static void
+joinedIds( DatabaseImpl* dbi, const QList<unsigned int>& fileIds, QSet<unsigned int>& trackIds, QSet<unsigned int>& albumIds, QSet<unsigned int>& artistIds )
+{
+    TomahawkSqlQuery query = dbi->newquery();
+    for ( int i = 0; i < fileIds.count(); i += ID_BATCH )
+    {
+        QStringList ids;
+        foreach ( unsigned int id, fileIds.mid( i, ID_BATCH ) )
+            ids << QString::number( id );
+
+        query.exec( QString( "SELECT track, album, artist FROM file_join WHERE file IN ( %1 )" ).arg( ids.join( ", " ) ) );
+        while ( query.next() )
+        {
+            trackIds << query.value( 0 ).toUInt();
+            if ( !query.value( 1 ).isNull() )
+                albumIds << query.value( 1 ).toUInt();
+            artistIds << query.value( 2 ).toUInt();
+        }
+    }
+}
+
+
+// returns the ones of ids no file refers to anymore, column is "track", "album" or "artist"
+static QList<unsigned int>
+orphanedIds( DatabaseImpl* dbi, const QString& column, const QSet<unsigned int>& ids )
+{
+    QSet<unsigned int> orphaned = ids;
+    const QList<unsigned int> idList = ids.toList();
+
+    TomahawkSqlQuery query = dbi->newquery();
+    for ( int i = 0; i < idList.count(); i += ID_BATCH )
+    {
+        QStringList batch;
+        foreach ( unsigned int id, idList.mid( i, ID_BATCH ) )
+            batch << QString::number( id );
+
+        query.exec( QString( "SELECT DISTINCT %1 FROM file_join WHERE %1 IN ( %2 )" ).arg( column ).arg( batch.join( ", " ) ) );
+        while ( query.next() )
+            orphaned.remove( query.value( 0 ).toUInt() );
+    }
+
+    return orphaned.toList();
+}
+
+
 void
 DatabaseCommand_DeleteFiles::exec( DatabaseImpl* dbi )
 {
@@ -98,8 +154,11 @@ DatabaseCommand_DeleteFiles::exec( DatabaseImpl* dbi )
         }
     }
 
+    QSet<unsigned int> trackIds, albumIds, artistIds;
     if ( m_deleteAll )
     {
+        joinedIds( dbi, m_idList, trackIds, albumIds, artistIds );
+
         delquery.prepare( QString( "DELETE FROM file WHERE source %1" )
                     .arg( source()->isLocal() ? "IS NULL" : QString( "= %1" ).arg( source()->id() ) ) );
         delquery.exec();
@@ -127,14 +186,21 @@ DatabaseCommand_DeleteFiles::exec( DatabaseImpl* dbi )
             idstring.chop( 2 ); //remove the trailing ", "
         }
 
+        joinedIds( dbi, m_idList, trackIds, albumIds, artistIds );
+
         delquery.prepare( QString( "DELETE FROM file WHERE source %1 AND id IN ( %2 )" )
                              .arg( source()->isLocal() ? "IS NULL" : QString( "= %1" ).arg( source()->id() ) )
                              .arg( idstring ) );
         delquery.exec();
     }
 
+    // other sources may still have files of these tracks, albums & artists
+    m_orphanedTracks = orphanedIds( dbi, "track", trackIds );
+    m_orphanedAlbums = orphanedIds( dbi, "album", albumIds );
+    m_orphanedArtists = orphanedIds( dbi, "artist", artistIds );
+
     if ( m_idList.count() )
-        source()->updateIndexWhenSynced();
+        source()->updateStatsWhenSynced();
 
     emit done( m_idList, source()->collection() );
 }
@@ -83,6 +83,11 @@ private:
     QVariantList m_ids;
     QList<unsigned int> m_idList;
     bool m_deleteAll;
+
+    // removed from the search index once the files are committed
+    QList<unsigned int> m_orphanedTracks;
+    QList<unsigned int> m_orphanedAlbums;
+    QList<unsigned int> m_orphanedArtists;
 };
 
 #endif // DATABASECOMMAND_DELETEFILES_H
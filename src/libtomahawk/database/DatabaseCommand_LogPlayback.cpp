@@ -117,7 +117,39 @@ DatabaseCommand_LogPlayback::exec( DatabaseImpl* dbi )
     query.bindValue( 2, m_playtime );
     query.bindValue( 3, m_secsPlayed );
 
+    if ( query.exec() )
+        updateStats( dbi, srcid, trkid );
+}
+
+
+void
+DatabaseCommand_LogPlayback::updateStats( DatabaseImpl* dbi, const QVariant& srcid, int trkid )
+{
+    const QString sourceToken = srcid.isNull() ? "IS NULL" : "= ?";
+
+    TomahawkSqlQuery query = dbi->newquery();
+    query.prepare( QString( "UPDATE playback_stats SET plays = plays + 1, secs_played = secs_played + ?, "
+                            "first_played = min( first_played, ? ), last_played = max( last_played, ? ) "
+                            "WHERE source %1 AND track = ?" ).arg( sourceToken ) );
+    query.addBindValue( m_secsPlayed );
+    query.addBindValue( m_playtime );
+    query.addBindValue( m_playtime );
+    if ( !srcid.isNull() )
+        query.addBindValue( srcid );
+    query.addBindValue( trkid );
     query.exec();
+
+    if ( query.numRowsAffected() < 1 )
+    {
+        query.prepare( "INSERT INTO playback_stats(source, track, plays, secs_played, first_played, last_played) "
+                       "VALUES (?, ?, 1, ?, ?, ?)" );
+        query.addBindValue( srcid );
+        query.addBindValue( trkid );
+        query.addBindValue( m_secsPlayed );
+        query.addBindValue( m_playtime );
+        query.addBindValue( m_playtime );
+        query.exec();
+    }
 }
 
 
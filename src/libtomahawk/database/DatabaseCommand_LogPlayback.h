@@ -106,6 +106,9 @@ signals:
     void trackPlayed( const Tomahawk::query_ptr& query );
 
 private:
+    // keeps playback_stats in sync with the playback_log
+    void updateStats( DatabaseImpl* dbi, const QVariant& srcid, int trkid );
+
     Tomahawk::result_ptr m_result;
     Tomahawk::query_ptr m_query;
 
@@ -0,0 +1,35 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2026, agent <agent@local>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DatabaseCommand_MergeSearchIndex.h"
+
+#include "DatabaseImpl.h"
+
+
+DatabaseCommand_MergeSearchIndex::DatabaseCommand_MergeSearchIndex()
+    : DatabaseCommand()
+{
+    setPriority( DatabaseCommand::Background );
+}
+
+
+void
+DatabaseCommand_MergeSearchIndex::exec( DatabaseImpl* db )
+{
+    db->mergeSearchIndex();
+}
@@ -0,0 +1,37 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2026, agent <agent@local>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DATABASECOMMAND_MERGESEARCHINDEX_H
+#define DATABASECOMMAND_MERGESEARCHINDEX_H
+
+#include "DatabaseCommand.h"
+#include "DllMacro.h"
+
+// merges the segments incremental search index updates leave behind, see FuzzyIndex::mergeIndex()
+class DLLEXPORT DatabaseCommand_MergeSearchIndex : public DatabaseCommand
+{
+Q_OBJECT
+public:
+    explicit DatabaseCommand_MergeSearchIndex();
+
+    virtual QString commandname() const { return "mergesearchindex"; }
+    virtual bool doesMutates() const { return false; }
+    virtual void exec( DatabaseImpl* db );
+};
+
+#endif // DATABASECOMMAND_MERGESEARCHINDEX_H
@@ -35,49 +35,41 @@ DatabaseCommand_PlaybackHistory::exec( DatabaseImpl* dbi )
     QString whereToken;
     if ( !source().isNull() )
     {
-        whereToken = QString( "WHERE source %1" ).arg( source()->isLocal() ? "IS NULL" : QString( "= %1" ).arg( source()->id() ) );
+        whereToken = QString( "AND playback_log.source %1" ).arg( source()->isLocal() ? "IS NULL" : "= ?" );
     }
 
     QString sql = QString(
-            "SELECT track, playtime, secs_played, source "
-            "FROM playback_log "
+            "SELECT playback_log.track, playback_log.playtime, playback_log.secs_played, playback_log.source, "
+                   "track.name, artist.name "
+            "FROM playback_log, track, artist "
+            "WHERE track.id = playback_log.track "
+            "AND artist.id = track.artist "
             "%1 "
-            "ORDER BY playtime DESC "
+            "ORDER BY playback_log.playtime DESC "
             "%2" ).arg( whereToken )
-                  .arg( m_amount > 0 ? QString( "LIMIT 0, %1" ).arg( m_amount ) : QString() );
+                  .arg( m_amount > 0 ? "LIMIT 0, ?" : QString() );
 
     query.prepare( sql );
+    if ( !source().isNull() && !source()->isLocal() )
+        query.addBindValue( source()->id() );
+    if ( m_amount > 0 )
+        query.addBindValue( m_amount );
     query.exec();
 
     while( query.next() )
     {
-        TomahawkSqlQuery query_track = dbi->newquery();
+        Tomahawk::query_ptr q = Tomahawk::Query::get( query.value( 5 ).toString(), query.value( 4 ).toString(), QString() );
 
-        QString sql = QString(
-                "SELECT track.name, artist.name "
-                "FROM track, artist "
-                "WHERE artist.id = track.artist "
-                "AND track.id = %1"
-                ).arg( query.value( 0 ).toUInt() );
-
-        query_track.prepare( sql );
-        query_track.exec();
-
-        if ( query_track.next() )
+        if ( query.value( 3 ).toUInt() == 0 )
         {
-            Tomahawk::query_ptr q = Tomahawk::Query::get( query_track.value( 1 ).toString(), query_track.value( 0 ).toString(), QString() );
-
-            if ( query.value( 3 ).toUInt() == 0 )
-            {
-                q->setPlayedBy( SourceList::instance()->getLocal(), query.value( 1 ).toUInt() );
-            }
-            else
-            {
-                q->setPlayedBy( SourceList::instance()->get( query.value( 3 ).toUInt() ), query.value( 1 ).toUInt() );
-            }
-
-            ql << q;
+            q->setPlayedBy( SourceList::instance()->getLocal(), query.value( 1 ).toUInt() );
         }
+        else
+        {
+            q->setPlayedBy( SourceList::instance()->get( query.value( 3 ).toUInt() ), query.value( 1 ).toUInt() );
+        }
+
+        ql << q;
     }
 
     if ( ql.count() )
@@ -26,12 +26,29 @@
 
 using namespace Tomahawk;
 
+// how many of the best index hits get looked up per query
+#define MAX_TRACK_CANDIDATES 50
+#define MAX_FULLTEXT_CANDIDATES 100
+#define MAX_ARTIST_CANDIDATES 20
+#define MAX_ALBUM_CANDIDATES 20
+
 
 DatabaseCommand_Resolve::DatabaseCommand_Resolve( const query_ptr& query )
     : DatabaseCommand()
-    , m_query( query )
 {
     Q_ASSERT( Pipeline::instance()->isRunning() );
+    setPriority( DatabaseCommand::Resolve );
+
+    m_queries << query;
+}
+
+
+DatabaseCommand_Resolve::DatabaseCommand_Resolve( const QList< query_ptr >& queries )
+    : DatabaseCommand()
+    , m_queries( queries )
+{
+    Q_ASSERT( Pipeline::instance()->isRunning() );
+    setPriority( DatabaseCommand::Resolve );
 }
 
 
@@ -48,52 +65,75 @@ DatabaseCommand_Resolve::exec( DatabaseImpl* lib )
      *        1) find list of trk/art/alb IDs that are reasonable matches to the metadata given
      *        2) find files in database by permitted sources and calculate score, ignoring
      *           results that are less than MINSCORE
+     *
+     *        All regular queries of a batch share these two stages: one pass over
+     *        the index and a single SQL query for the files of all candidates.
      */
 
-    if ( !m_query->resultHint().isEmpty() )
+    QList< query_ptr > queries;
+    foreach ( const query_ptr& query, m_queries )
     {
-        qDebug() << "Using result-hint to speed up resolving:" << m_query->resultHint();
-
-        Tomahawk::result_ptr result = lib->resultFromHint( m_query );
-        if ( !result.isNull() && !result->collection().isNull() && result->collection()->source()->isOnline() )
+        if ( !query->resultHint().isEmpty() )
         {
-            QList<Tomahawk::result_ptr> res;
-            res << result;
-            emit results( m_query->id(), res );
-            return;
+            qDebug() << "Using result-hint to speed up resolving:" << query->resultHint();
+
+            Tomahawk::result_ptr result = lib->resultFromHint( query );
+            if ( !result.isNull() && !result->collection().isNull() && result->collection()->source()->isOnline() )
+            {
+                QList<Tomahawk::result_ptr> res;
+                res << result;
+                emit results( query->id(), res );
+                continue;
+            }
         }
+
+        if ( query->isFullTextQuery() )
+            fullTextResolve( lib, query );
+        else
+            queries << query;
     }
 
-    if ( m_query->isFullTextQuery() )
-        fullTextResolve( lib );
-    else
-        resolve( lib );
+    if ( !queries.isEmpty() )
+        resolve( lib, queries );
 }
 
 
 void
-DatabaseCommand_Resolve::resolve( DatabaseImpl* lib )
+DatabaseCommand_Resolve::resolve( DatabaseImpl* lib, const QList< query_ptr >& queries )
 {
-    QList<Tomahawk::result_ptr> res;
     typedef QPair<int, float> scorepair_t;
 
     // STEP 1
-    QList< QPair<int, float> > tracks = lib->search( m_query );
+    QList< QList< scorepair_t > > candidates = lib->search( queries, MAX_TRACK_CANDIDATES );
+
+    // map each candidate track to all the queries it might satisfy
+    QHash< int, QList< query_ptr > > trackQueries;
+    QStringList trksl;
+    for ( int i = 0; i < candidates.count(); i++ )
+    {
+        foreach ( const scorepair_t& pair, candidates.at( i ) )
+        {
+            if ( !trackQueries.contains( pair.first ) )
+                trksl.append( QString::number( pair.first ) );
+
+            trackQueries[ pair.first ] << queries.at( i );
+        }
+    }
 
-    if ( tracks.length() == 0 )
+    QHash< QID, QList< Tomahawk::result_ptr > > res;
+    if ( trksl.isEmpty() )
     {
-        qDebug() << "No candidates found in first pass, aborting resolve" << m_query->artist() << m_query->track();
-        emit results( m_query->id(), res );
+        foreach ( const query_ptr& query, queries )
+        {
+            qDebug() << "No candidates found in first pass, aborting resolve" << query->artist() << query->track();
+            emit results( query->id(), res.value( query->id() ) );
+        }
         return;
     }
 
     // STEP 2
     TomahawkSqlQuery files_query = lib->newquery();
 
-    QStringList trksl;
-    for ( int k = 0; k < tracks.count(); k++ )
-        trksl.append( QString::number( tracks.at( k ).first ) );
-
     QString trksToken = QString( "file_join.track IN (%1)" ).arg( trksl.join( "," ) );
 
     QString sql = QString( "SELECT "
@@ -122,10 +162,12 @@ DatabaseCommand_Resolve::resolve( DatabaseImpl* lib )
     files_query.prepare( sql );
     files_query.exec();
 
+    QList< Tomahawk::result_ptr > newResults;
     while ( files_query.next() )
     {
         source_ptr s;
         QString url = files_query.value( 0 ).toString();
+        const QList< query_ptr > wanted = trackQueries.value( files_query.value( 9 ).toInt() );
 
         if ( files_query.value( 16 ).toUInt() == 0 )
         {
@@ -148,7 +190,8 @@ DatabaseCommand_Resolve::resolve( DatabaseImpl* lib )
         if ( cached )
         {
             qDebug() << "Result already cached:" << result->toString();
-            res << result;
+            foreach ( const query_ptr& query, wanted )
+                res[ query->id() ] << result;
             continue;
         }
 
@@ -170,60 +213,41 @@ DatabaseCommand_Resolve::resolve( DatabaseImpl* lib )
         result->setAlbumPos( files_query.value( 17 ).toUInt() );
         result->setTrackId( files_query.value( 9 ).toUInt() );
 
-        TomahawkSqlQuery attrQuery = lib->newquery();
-        QVariantMap attr;
-
-        attrQuery.prepare( "SELECT k, v FROM track_attributes WHERE id = ?" );
-        attrQuery.bindValue( 0, result->trackId() );
-        attrQuery.exec();
-        while ( attrQuery.next() )
-        {
-            attr[ attrQuery.value( 0 ).toString() ] = attrQuery.value( 1 ).toString();
-        }
-
-        result->setAttributes( attr );
+        newResults << result;
         result->setCollection( s->collection() );
 
-        res << result;
+        foreach ( const query_ptr& query, wanted )
+            res[ query->id() ] << result;
     }
 
-    emit results( m_query->id(), res );
+    lib->loadTrackAttributes( newResults );
+
+    foreach ( const query_ptr& query, queries )
+        emit results( query->id(), res.value( query->id() ) );
 }
 
 
 void
-DatabaseCommand_Resolve::fullTextResolve( DatabaseImpl* lib )
+DatabaseCommand_Resolve::fullTextResolve( DatabaseImpl* lib, const query_ptr& query )
 {
     QList<Tomahawk::result_ptr> res;
-    typedef QPair<int, float> scorepair_t;
 
     // STEP 1
-    QList< QPair<int, float> > trackPairs = lib->search( m_query );
-    QList< QPair<int, float> > albumPairs = lib->searchAlbum( m_query, 20 );
-
-    foreach ( const scorepair_t& albumPair, albumPairs )
-    {
-        TomahawkSqlQuery query = lib->newquery();
+    QList< QPair<int, float> > trackPairs = lib->search( query, MAX_FULLTEXT_CANDIDATES );
 
-        QString sql = QString( "SELECT album.name, artist.id, artist.name FROM album, artist WHERE artist.id = album.artist AND album.id = %1" ).arg( albumPair.first );
-        query.prepare( sql );
-        query.exec();
+    // artists & albums come with their names from the index, best match first
+    const QList< Tomahawk::artist_ptr > artistList = lib->searchArtists( query->fullTextQuery(), MAX_ARTIST_CANDIDATES );
+    if ( !artistList.isEmpty() )
+        emit artists( query->id(), artistList );
 
-        QList<Tomahawk::album_ptr> albumList;
-        while ( query.next() )
-        {
-            Tomahawk::artist_ptr artist = Tomahawk::Artist::get( query.value( 1 ).toUInt(), query.value( 2 ).toString() );
-            Tomahawk::album_ptr album = Tomahawk::Album::get( albumPair.first, query.value( 0 ).toString(), artist );
-            albumList << album;
-        }
+    const QList< Tomahawk::album_ptr > albumList = lib->searchAlbums( query->fullTextQuery(), MAX_ALBUM_CANDIDATES );
+    if ( !albumList.isEmpty() )
+        emit albums( query->id(), albumList );
 
-        emit albums( m_query->id(), albumList );
-    }
-    
     if ( trackPairs.length() == 0 )
     {
-        qDebug() << "No candidates found in first pass, aborting resolve" << m_query->fullTextQuery();
-        emit results( m_query->id(), res );
+        qDebug() << "No candidates found in first pass, aborting resolve" << query->fullTextQuery();
+        emit results( query->id(), res );
         return;
     }
 
@@ -261,6 +285,7 @@ DatabaseCommand_Resolve::fullTextResolve( DatabaseImpl* lib )
     files_query.prepare( sql );
     files_query.exec();
 
+    QList< Tomahawk::result_ptr > newResults;
     while ( files_query.next() )
     {
         source_ptr s;
@@ -318,22 +343,13 @@ DatabaseCommand_Resolve::fullTextResolve( DatabaseImpl* lib )
             }
         }
 
-        TomahawkSqlQuery attrQuery = lib->newquery();
-        QVariantMap attr;
-
-        attrQuery.prepare( "SELECT k, v FROM track_attributes WHERE id = ?" );
-        attrQuery.bindValue( 0, result->trackId() );
-        attrQuery.exec();
-        while ( attrQuery.next() )
-        {
-            attr[ attrQuery.value( 0 ).toString() ] = attrQuery.value( 1 ).toString();
-        }
-
-        result->setAttributes( attr );
+        newResults << result;
         result->setCollection( s->collection() );
 
         res << result;
     }
 
-    emit results( m_query->id(), res );
+    lib->loadTrackAttributes( newResults );
+
+    emit results( query->id(), res );
 }
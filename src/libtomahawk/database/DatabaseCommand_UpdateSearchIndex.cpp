@@ -36,7 +36,11 @@ DatabaseCommand_UpdateSearchIndex::DatabaseCommand_UpdateSearchIndex()
 {
     tLog() << Q_FUNC_INFO << "Updating index.";
 
-    JobStatusView::instance()->model()->addJob( m_statusJob.data() );
+    // there is no job view without a GUI
+    if ( JobStatusView::instance() )
+        JobStatusView::instance()->model()->addJob( m_statusJob.data() );
+    else
+        delete m_statusJob.data();
 }
 
 
@@ -55,13 +59,15 @@ DatabaseCommand_UpdateSearchIndex::exec( DatabaseImpl* db )
     QMap< unsigned int, QMap< QString, QString > > data;
     TomahawkSqlQuery q = db->newquery();
 
-    q.exec( "SELECT track.id, track.name, artist.name, artist.id FROM track, artist WHERE artist.id = track.artist" );
+    // only what some file refers to. Tracks, albums & artists only known from playback logs, playlists
+    // or social actions are left out, just like AddFiles and DeleteFiles do when updating the index
+    q.exec( "SELECT track.id, track.name, artist.name FROM track, artist "
+            "WHERE artist.id = track.artist AND track.id IN ( SELECT track FROM file_join )" );
     while ( q.next() )
     {
         QMap< QString, QString > track;
         track.insert( "track", q.value( 1 ).toString() );
         track.insert( "artist", q.value( 2 ).toString() );
-        track.insert( "artistid", q.value( 3 ).toString() );
 
         data.insert( q.value( 0 ).toUInt(), track );
     }
@@ -69,15 +75,30 @@ DatabaseCommand_UpdateSearchIndex::exec( DatabaseImpl* db )
     db->m_fuzzyIndex->appendFields( data );
     data.clear();
 
-    q.exec( "SELECT album.id, album.name FROM album" );
+    q.exec( "SELECT album.id, album.name, artist.id, artist.name FROM album, artist "
+            "WHERE artist.id = album.artist AND album.id IN ( SELECT album FROM file_join )" );
     while ( q.next() )
     {
         QMap< QString, QString > album;
         album.insert( "album", q.value( 1 ).toString() );
+        album.insert( "artistid", q.value( 2 ).toString() );
+        album.insert( "artist", q.value( 3 ).toString() );
 
         data.insert( q.value( 0 ).toUInt(), album );
     }
 
+    db->m_fuzzyIndex->appendFields( data );
+    data.clear();
+
+    q.exec( "SELECT artist.id, artist.name FROM artist WHERE artist.id IN ( SELECT artist FROM file_join )" );
+    while ( q.next() )
+    {
+        QMap< QString, QString > artist;
+        artist.insert( "artist", q.value( 1 ).toString() );
+
+        data.insert( q.value( 0 ).toUInt(), artist );
+    }
+
     db->m_fuzzyIndex->appendFields( data );
 
     qDebug() << "Building index finished.";
@@ -32,6 +32,8 @@ public:
     virtual ~DatabaseCommand_UpdateSearchIndex();
 
     virtual QString commandname() const { return "updatesearchindex"; }
+    // runs on the RW worker, in order with the commands that update the index incrementally,
+    // so it can't be given a priority
     virtual bool doesMutates() const { return true; }
     virtual void exec( DatabaseImpl* db );
 
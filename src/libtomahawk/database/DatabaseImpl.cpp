@@ -21,10 +21,12 @@
 #include "DatabaseImpl.h"
 
 #include <QCoreApplication>
+#include <QMutex>
 #include <QRegExp>
 #include <QStringList>
 #include <QtAlgorithms>
 #include <QFile>
+#include <QFileInfo>
 
 #include "database/Database.h"
 #include "DatabaseCommand_UpdateSearchIndex.h"
@@ -41,14 +43,37 @@
 */
 #include "Schema.sql.h"
 
-#define CURRENT_SCHEMA_VERSION 28
-
-
-DatabaseImpl::DatabaseImpl( const QString& dbname, Database* parent )
+#define CURRENT_SCHEMA_VERSION 29
+#define MAX_INTERNED_SORTNAMES 100000
+#define MAX_CACHED_STATEMENTS 100
+#define TRACK_ATTRIBUTES_BATCH 500
+#define MAX_CACHED_IDS 10000
+// how many names get looked up with a single query, sqlite allows 999 bound values per statement
+#define ID_LOOKUP_BATCH 500
+// sqlite's default limits for bound values and for the terms of a compound SELECT
+#define MAX_BOUND_VALUES 999
+#define MAX_COMPOUND_SELECT 500
+// how often the statement cache reports its hit rate to LOGSQL
+#define STATEMENT_STATS_INTERVAL 1000
+
+// every distinct name only gets normalized once, and all its users share the same string
+static QHash< QString, QString > s_sortnames;
+static QMutex s_sortnamesMutex;
+
+
+DatabaseImpl::DatabaseImpl( const QString& dbname, bool trigramIndex, Database* parent )
     : QObject( (QObject*) parent )
-    , m_lastartid( 0 )
-    , m_lastalbid( 0 )
-    , m_lasttrkid( 0 )
+    , m_dbname( dbname )
+    , m_connectionName( "tomahawk" )
+    , m_readOnly( false )
+    , m_isClone( false )
+    , m_artistIds( MAX_CACHED_IDS )
+    , m_trackIds( MAX_CACHED_IDS )
+    , m_albumIds( MAX_CACHED_IDS )
+    , m_inTransaction( false )
+    , m_statements( MAX_CACHED_STATEMENTS )
+    , m_statementHits( 0 )
+    , m_statementMisses( 0 )
 {
     QTime t;
     t.start();
@@ -71,7 +96,10 @@ DatabaseImpl::DatabaseImpl( const QString& dbname, Database* parent )
 
      // make sqlite behave how we want:
     query.exec( "PRAGMA auto_vacuum = FULL" );
-    query.exec( "PRAGMA synchronous  = ON" );
+    // with a write-ahead log readers on other connections don't block while we commit.
+    // NORMAL is still safe against corruption in WAL mode, only the last commit may be lost on power failure
+    query.exec( "PRAGMA journal_mode = WAL" );
+    query.exec( "PRAGMA synchronous  = NORMAL" );
     query.exec( "PRAGMA foreign_keys = ON" );
     //query.exec( "PRAGMA temp_store = MEMORY" );
     tDebug( LOGVERBOSE ) << "Tweaked db pragmas:" << t.elapsed();
@@ -79,8 +107,8 @@ DatabaseImpl::DatabaseImpl( const QString& dbname, Database* parent )
     // in case of unclean shutdown last time:
     query.exec( "UPDATE source SET isonline = 'false'" );
 
-    m_fuzzyIndex = new FuzzyIndex( *this, schemaUpdated );
-    if ( schemaUpdated )
+    m_fuzzyIndex = new FuzzyIndex( *this, trigramIndex, schemaUpdated );
+    if ( schemaUpdated || !m_fuzzyIndex->indexExists() )
         QTimer::singleShot( 0, this, SLOT( updateIndex() ) );
 
     tDebug( LOGVERBOSE ) << "Loaded index:" << t.elapsed();
@@ -93,8 +121,59 @@ DatabaseImpl::DatabaseImpl( const QString& dbname, Database* parent )
 }
 
 
+DatabaseImpl::DatabaseImpl( const QString& dbname, const QString& dbid, FuzzyIndex* fuzzyIndex, bool readOnly )
+    : QObject()
+    , m_dbname( dbname )
+    , m_connectionName( QString( "tomahawk-%1" ).arg( uuid() ) )
+    , m_readOnly( readOnly )
+    , m_isClone( true )
+    , m_artistIds( MAX_CACHED_IDS )
+    , m_trackIds( MAX_CACHED_IDS )
+    , m_albumIds( MAX_CACHED_IDS )
+    , m_inTransaction( false )
+    , m_dbid( dbid )
+    , m_fuzzyIndex( fuzzyIndex )
+    , m_statements( MAX_CACHED_STATEMENTS )
+    , m_statementHits( 0 )
+    , m_statementMisses( 0 )
+{
+    m_db = QSqlDatabase::addDatabase( "QSQLITE", m_connectionName );
+    m_db.setDatabaseName( dbname );
+    if ( readOnly )
+        m_db.setConnectOptions( "QSQLITE_OPEN_READONLY" );
+
+    // clone() hands out connections that failed to open as 0
+    if ( !m_db.open() )
+    {
+        tLog() << "Failed to open database connection" << m_connectionName << "to" << dbname << ":" << m_db.lastError().text();
+        return;
+    }
+
+    // journal_mode is stored in the database file, but these are per connection
+    TomahawkSqlQuery query = newquery();
+    query.exec( "PRAGMA foreign_keys = ON" );
+    if ( !readOnly )
+        query.exec( "PRAGMA synchronous  = NORMAL" );
+
+    tDebug( LOGVERBOSE ) << "Opened database connection" << m_connectionName << "read-only:" << readOnly;
+}
+
+
 DatabaseImpl::~DatabaseImpl()
 {
+    logStatementStats();
+    // cached statements must be gone before the connection is closed
+    m_statements.clear();
+
+    if ( m_isClone )
+    {
+        // the search index belongs to the DatabaseImpl we got cloned from
+        m_db.close();
+        m_db = QSqlDatabase();
+        QSqlDatabase::removeDatabase( m_connectionName );
+        return;
+    }
+
     delete m_fuzzyIndex;
     
     tDebug() << "Shutting down database.";
@@ -115,6 +194,55 @@ DatabaseImpl::~DatabaseImpl()
 }
 
 
+DatabaseImpl*
+DatabaseImpl::clone( bool readOnly ) const
+{
+    DatabaseImpl* impl = new DatabaseImpl( m_dbname, m_dbid, m_fuzzyIndex, readOnly );
+    if ( !impl->database().isOpen() )
+    {
+        delete impl;
+        return 0;
+    }
+
+    return impl;
+}
+
+
+QSqlQuery*
+DatabaseImpl::takeStatement( const QString& sql )
+{
+    QSqlQuery* query = m_statements.take( sql );
+    if ( query )
+        m_statementHits++;
+    else
+        m_statementMisses++;
+
+    if ( ( m_statementHits + m_statementMisses ) % STATEMENT_STATS_INTERVAL == 0 )
+        logStatementStats();
+
+    return query;
+}
+
+
+void
+DatabaseImpl::returnStatement( const QString& sql, const QSqlQuery& query )
+{
+    m_statements.insert( sql, new QSqlQuery( query ) );
+}
+
+
+void
+DatabaseImpl::logStatementStats() const
+{
+    const unsigned int lookups = m_statementHits + m_statementMisses;
+    if ( !lookups )
+        return;
+
+    tLog( LOGSQL ) << "Statement cache of" << m_connectionName << ":" << m_statements.count() << "statements,"
+                   << lookups << "lookups," << m_statementHits * 100 / lookups << "% hits";
+}
+
+
 void
 DatabaseImpl::dumpDatabase()
 {
@@ -282,15 +410,33 @@ DatabaseImpl::file( int fid )
 }
 
 
+static QString
+childKey( int artistid, const QString& sortname )
+{
+    return QString::number( artistid ) + '\t' + sortname;
+}
+
+
+// "?, ?, ?" and the like
+static QString
+repeated( const QString& str, int count, const QString& separator )
+{
+    QStringList list;
+    for ( int i = 0; i < count; i++ )
+        list << str;
+
+    return list.join( separator );
+}
+
+
 int
 DatabaseImpl::artistId( const QString& name_orig, bool autoCreate )
 {
-    if ( m_lastart == name_orig )
-        return m_lastartid;
+    const QString sortname = DatabaseImpl::sortname( name_orig );
+    if ( int* cached = m_artistIds.object( sortname ) )
+        return *cached;
 
     int id = 0;
-    QString sortname = DatabaseImpl::sortname( name_orig );
-
     TomahawkSqlQuery query = newquery();
     query.prepare( "SELECT id FROM artist WHERE sortname = ?" );
     query.addBindValue( sortname );
@@ -299,14 +445,8 @@ DatabaseImpl::artistId( const QString& name_orig, bool autoCreate )
     {
         id = query.value( 0 ).toInt();
     }
-    if ( id )
-    {
-        m_lastart = name_orig;
-        m_lastartid = id;
-        return id;
-    }
 
-    if ( autoCreate )
+    if ( !id && autoCreate )
     {
         // not found, insert it.
         query.prepare( "INSERT INTO artist(id,name,sortname) VALUES(NULL,?,?)" );
@@ -319,10 +459,11 @@ DatabaseImpl::artistId( const QString& name_orig, bool autoCreate )
         }
 
         id = query.lastInsertId().toInt();
-        m_lastart = name_orig;
-        m_lastartid = id;
     }
 
+    if ( id )
+        cacheId( m_artistIds, m_uncommittedArtistIds, sortname, id );
+
     return id;
 }
 
@@ -330,147 +471,367 @@ DatabaseImpl::artistId( const QString& name_orig, bool autoCreate )
 int
 DatabaseImpl::trackId( int artistid, const QString& name_orig, bool autoCreate )
 {
-    int id = 0;
-    QString sortname = DatabaseImpl::sortname( name_orig );
-    //if( ( id = m_artistcache[sortname] ) ) return id;
+    return childId( "track", m_trackIds, m_uncommittedTrackIds, artistid, name_orig, autoCreate );
+}
+
+
+int
+DatabaseImpl::albumId( int artistid, const QString& name_orig, bool autoCreate )
+{
+    if ( name_orig.isEmpty() )
+    {
+        //qDebug() << Q_FUNC_INFO << "empty album name";
+        return 0;
+    }
+
+    return childId( "album", m_albumIds, m_uncommittedAlbumIds, artistid, name_orig, autoCreate );
+}
 
+
+int
+DatabaseImpl::childId( const QString& table, QCache< QString, int >& cache, QStringList& uncommitted,
+                       int artistid, const QString& name_orig, bool autoCreate )
+{
+    const QString sortname = DatabaseImpl::sortname( name_orig );
+    const QString key = childKey( artistid, sortname );
+    if ( int* cached = cache.object( key ) )
+        return *cached;
+
+    int id = 0;
     TomahawkSqlQuery query = newquery();
-    query.prepare( "SELECT id FROM track WHERE artist = ? AND sortname = ?" );
+    query.prepare( QString( "SELECT id FROM %1 WHERE artist = ? AND sortname = ?" ).arg( table ) );
     query.addBindValue( artistid );
     query.addBindValue( sortname );
     query.exec();
-
     if ( query.next() )
     {
         id = query.value( 0 ).toInt();
     }
-    if ( id )
-    {
-        //m_trackcache[sortname]=id;
-        return id;
-    }
 
-    if ( autoCreate )
+    if ( !id && autoCreate )
     {
         // not found, insert it.
-        query.prepare( "INSERT INTO track(id,artist,name,sortname) VALUES(NULL,?,?,?)" );
+        query.prepare( QString( "INSERT INTO %1(id,artist,name,sortname) VALUES(NULL,?,?,?)" ).arg( table ) );
         query.addBindValue( artistid );
         query.addBindValue( name_orig );
         query.addBindValue( sortname );
         if ( !query.exec() )
         {
-            tDebug() << "Failed to insert track:" << name_orig;
+            tDebug() << "Failed to insert" << table << ":" << name_orig;
             return 0;
         }
 
         id = query.lastInsertId().toInt();
     }
 
+    if ( id )
+        cacheId( cache, uncommitted, key, id );
+
     return id;
 }
 
 
-int
-DatabaseImpl::albumId( int artistid, const QString& name_orig, bool autoCreate )
+QHash< QString, int >
+DatabaseImpl::artistIds( const QStringList& names, bool autoCreate )
 {
-    if ( name_orig.isEmpty() )
+    QHash< QString, int > ids;
+    QHash< QString, QStringList > missing; // names by sortname
+    foreach ( const QString& name, names )
     {
-        //qDebug() << Q_FUNC_INFO << "empty album name";
-        return 0;
+        if ( ids.contains( name ) )
+            continue;
+
+        const QString sortname = DatabaseImpl::sortname( name );
+        if ( int* cached = m_artistIds.object( sortname ) )
+            ids.insert( name, *cached );
+        else if ( !missing.value( sortname ).contains( name ) )
+            missing[ sortname ] << name;
     }
 
-    if ( m_lastartid == artistid && m_lastalb == name_orig )
-        return m_lastalbid;
+    lookupArtistIds( missing, ids );
+    if ( autoCreate && !missing.isEmpty() )
+    {
+        // whatever is left doesn't exist yet. Insert it all at once, then fetch the new ids
+        QVariantList values;
+        foreach ( const QString& sortname, missing.keys() )
+            values << missing.value( sortname ).first() << sortname;
 
-    int id = 0;
-    QString sortname = DatabaseImpl::sortname( name_orig );
-    //if( ( id = m_albumcache[sortname] ) ) return id;
+        if ( !insertRows( "INSERT OR IGNORE INTO artist(name, sortname)", 2, values ) )
+            tDebug() << "Failed to insert" << missing.count() << "artists";
 
-    TomahawkSqlQuery query = newquery();
-    query.prepare( "SELECT id FROM album WHERE artist = ? AND sortname = ?" );
-    query.addBindValue( artistid );
-    query.addBindValue( sortname );
-    query.exec();
-    if ( query.next() )
+        lookupArtistIds( missing, ids );
+    }
+
+    return ids;
+}
+
+
+void
+DatabaseImpl::lookupArtistIds( QHash< QString, QStringList >& missing, QHash< QString, int >& ids )
+{
+    const QStringList sortnames = missing.keys();
+    for ( int i = 0; i < sortnames.count(); i += ID_LOOKUP_BATCH )
     {
-        id = query.value( 0 ).toInt();
+        const QStringList batch = sortnames.mid( i, ID_LOOKUP_BATCH );
+
+        TomahawkSqlQuery query = newquery();
+        query.prepare( QString( "SELECT id, sortname FROM artist WHERE sortname IN (%1)" )
+                          .arg( repeated( "?", batch.count(), ", " ) ) );
+        foreach ( const QString& sortname, batch )
+            query.addBindValue( sortname );
+        query.exec();
+
+        while ( query.next() )
+        {
+            const int id = query.value( 0 ).toInt();
+            const QString sortname = query.value( 1 ).toString();
+            cacheId( m_artistIds, m_uncommittedArtistIds, sortname, id );
+
+            foreach ( const QString& name, missing.take( sortname ) )
+                ids.insert( name, id );
+        }
     }
-    if ( id )
+}
+
+
+QHash< QPair<int, QString>, int >
+DatabaseImpl::trackIds( const QList< QPair<int, QString> >& tracks, bool autoCreate )
+{
+    return childIds( "track", m_trackIds, m_uncommittedTrackIds, tracks, autoCreate );
+}
+
+
+QHash< QPair<int, QString>, int >
+DatabaseImpl::albumIds( const QList< QPair<int, QString> >& albums, bool autoCreate )
+{
+    QList< QPair<int, QString> > named;
+    for ( int i = 0; i < albums.count(); i++ )
     {
-        m_lastalb = name_orig;
-        m_lastalbid = id;
-        return id;
+        if ( !albums.at( i ).second.isEmpty() )
+            named << albums.at( i );
     }
 
-    if ( autoCreate )
+    return childIds( "album", m_albumIds, m_uncommittedAlbumIds, named, autoCreate );
+}
+
+
+QHash< QPair<int, QString>, int >
+DatabaseImpl::childIds( const QString& table, QCache< QString, int >& cache, QStringList& uncommitted,
+                        const QList< QPair<int, QString> >& children, bool autoCreate )
+{
+    typedef QPair<int, QString> Child;
+
+    QHash< Child, int > ids;
+    QHash< QString, QList< Child > > missing; // by artist id and sortname
+    foreach ( const Child& child, children )
     {
-        // not found, insert it.
-        query.prepare( "INSERT INTO album(id,artist,name,sortname) VALUES(NULL,?,?,?)" );
-        query.addBindValue( artistid );
-        query.addBindValue( name_orig );
-        query.addBindValue( sortname );
-        if( !query.exec() )
+        if ( ids.contains( child ) )
+            continue;
+
+        const QString key = childKey( child.first, DatabaseImpl::sortname( child.second ) );
+        if ( int* cached = cache.object( key ) )
+            ids.insert( child, *cached );
+        else if ( !missing.value( key ).contains( child ) )
+            missing[ key ] << child;
+    }
+
+    lookupChildIds( table, cache, uncommitted, missing, ids );
+    if ( autoCreate && !missing.isEmpty() )
+    {
+        // whatever is left doesn't exist yet. Insert it all at once, then fetch the new ids
+        QVariantList values;
+        foreach ( const QString& key, missing.keys() )
         {
-            tDebug() << "Failed to insert album:" << name_orig;
-            return 0;
+            const Child child = missing.value( key ).first();
+            values << child.first << child.second << key.mid( key.indexOf( '\t' ) + 1 );
         }
 
-        id = query.lastInsertId().toInt();
-        m_lastalb = name_orig;
-        m_lastalbid = id;
+        if ( !insertRows( QString( "INSERT OR IGNORE INTO %1(artist, name, sortname)" ).arg( table ), 3, values ) )
+            tDebug() << "Failed to insert" << missing.count() << table << "rows";
+
+        lookupChildIds( table, cache, uncommitted, missing, ids );
     }
 
-    return id;
+    return ids;
 }
 
 
-QList< QPair<int, float> >
-DatabaseImpl::search( const Tomahawk::query_ptr& query, uint limit )
+void
+DatabaseImpl::lookupChildIds( const QString& table, QCache< QString, int >& cache, QStringList& uncommitted,
+                              QHash< QString, QList< QPair<int, QString> > >& missing, QHash< QPair<int, QString>, int >& ids )
 {
-    QList< QPair<int, float> > resultslist;
-
-    QMap< int, float > resultsmap = m_fuzzyIndex->search( query );
-    foreach ( int i, resultsmap.keys() )
+    const QStringList keys = missing.keys();
+    for ( int i = 0; i < keys.count(); i += ID_LOOKUP_BATCH / 2 )
     {
-        resultslist << QPair<int, float>( i, (float)resultsmap.value( i ) );
+        const QStringList batch = keys.mid( i, ID_LOOKUP_BATCH / 2 );
+
+        TomahawkSqlQuery query = newquery();
+        query.prepare( QString( "SELECT id, artist, sortname FROM %1 WHERE %2" )
+                          .arg( table )
+                          .arg( repeated( "(artist = ? AND sortname = ?)", batch.count(), " OR " ) ) );
+        foreach ( const QString& key, batch )
+        {
+            query.addBindValue( missing.value( key ).first().first );
+            query.addBindValue( key.mid( key.indexOf( '\t' ) + 1 ) );
+        }
+        query.exec();
+
+        while ( query.next() )
+        {
+            const int id = query.value( 0 ).toInt();
+            const QString key = childKey( query.value( 1 ).toInt(), query.value( 2 ).toString() );
+            cacheId( cache, uncommitted, key, id );
+
+            typedef QPair<int, QString> Child;
+            foreach ( const Child& child, missing.take( key ) )
+                ids.insert( child, id );
+        }
     }
-    qSort( resultslist.begin(), resultslist.end(), DatabaseImpl::scorepairSorter );
+}
+
+
+bool
+DatabaseImpl::insertRows( const QString& insert, int columns, const QVariantList& values )
+{
+    Q_ASSERT( columns > 0 && values.count() % columns == 0 );
 
-    if ( !limit )
-        return resultslist;
+    // a compound SELECT instead of a multi-row VALUES clause also works with older sqlite versions
+    const int rowsPerBatch = qMin( MAX_COMPOUND_SELECT, MAX_BOUND_VALUES / columns );
+    const int rows = values.count() / columns;
+    const QString row = QString( "SELECT %1" ).arg( repeated( "?", columns, ", " ) );
 
-    QList< QPair<int, float> > resultscapped;
-    for ( int i = 0; i < (int)limit && i < resultsmap.count(); i++ )
+    for ( int i = 0; i < rows; i += rowsPerBatch )
     {
-        resultscapped << resultslist.at( i );
+        const int count = qMin( rowsPerBatch, rows - i );
+
+        TomahawkSqlQuery query = newquery();
+        query.prepare( QString( "%1 %2" ).arg( insert ).arg( repeated( row, count, " UNION ALL " ) ) );
+        for ( int j = i * columns; j < ( i + count ) * columns; j++ )
+            query.addBindValue( values.at( j ) );
+
+        if ( !query.exec() )
+            return false;
     }
 
-    return resultscapped;
+    return true;
+}
+
+
+void
+DatabaseImpl::cacheId( QCache< QString, int >& cache, QStringList& uncommitted, const QString& key, int id )
+{
+    cache.insert( key, new int( id ) );
+    if ( m_inTransaction )
+        uncommitted << key;
+}
+
+
+bool
+DatabaseImpl::transaction()
+{
+    m_inTransaction = m_db.transaction();
+    return m_inTransaction;
+}
+
+
+bool
+DatabaseImpl::commit()
+{
+    if ( !m_db.commit() )
+        return false;
+
+    m_inTransaction = false;
+    m_uncommittedArtistIds.clear();
+    m_uncommittedTrackIds.clear();
+    m_uncommittedAlbumIds.clear();
+    return true;
+}
+
+
+void
+DatabaseImpl::rollback()
+{
+    m_db.rollback();
+
+    discardUncommittedIds();
+    m_inTransaction = false;
+}
+
+
+void
+DatabaseImpl::discardUncommittedIds()
+{
+    // the rows these ids point to may be gone now
+    foreach ( const QString& key, m_uncommittedArtistIds )
+        m_artistIds.remove( key );
+    foreach ( const QString& key, m_uncommittedTrackIds )
+        m_trackIds.remove( key );
+    foreach ( const QString& key, m_uncommittedAlbumIds )
+        m_albumIds.remove( key );
+
+    m_uncommittedArtistIds.clear();
+    m_uncommittedTrackIds.clear();
+    m_uncommittedAlbumIds.clear();
 }
 
 
 QList< QPair<int, float> >
-DatabaseImpl::searchAlbum( const Tomahawk::query_ptr& query, uint limit )
+DatabaseImpl::search( const Tomahawk::query_ptr& query, uint limit )
 {
-    QList< QPair<int, float> > resultslist;
+    return m_fuzzyIndex->search( query, limit );
+}
 
-    QMap< int, float > resultsmap = m_fuzzyIndex->searchAlbum( query );
-    foreach ( int i, resultsmap.keys() )
-    {
-        resultslist << QPair<int, float>( i, (float)resultsmap.value( i ) );
-    }
-    qSort( resultslist.begin(), resultslist.end(), DatabaseImpl::scorepairSorter );
 
-    if ( !limit )
-        return resultslist;
+QList< QList< QPair<int, float> > >
+DatabaseImpl::search( const QList< Tomahawk::query_ptr >& queries, uint limit )
+{
+    return m_fuzzyIndex->search( queries, limit );
+}
+
+
+QList< Tomahawk::artist_ptr >
+DatabaseImpl::searchArtists( const QString& text, uint limit )
+{
+    QList< Tomahawk::artist_ptr > artists;
+    foreach ( const FuzzyIndex::NameMatch& match, m_fuzzyIndex->searchArtists( text, limit ) )
+        artists << Tomahawk::Artist::get( match.id, match.name );
 
-    QList< QPair<int, float> > resultscapped;
-    for ( int i = 0; i < (int)limit && i < resultsmap.count(); i++ )
+    return artists;
+}
+
+
+QList< Tomahawk::album_ptr >
+DatabaseImpl::searchAlbums( const QString& text, uint limit )
+{
+    QList< Tomahawk::album_ptr > albums;
+    foreach ( const FuzzyIndex::NameMatch& match, m_fuzzyIndex->searchAlbums( text, limit ) )
     {
-        resultscapped << resultslist.at( i );
+        Tomahawk::artist_ptr artist = Tomahawk::Artist::get( match.artistId, match.artistName );
+        albums << Tomahawk::Album::get( match.id, match.name, artist );
     }
 
-    return resultscapped;
+    return albums;
+}
+
+
+void
+DatabaseImpl::updateSearchIndex( const QMap< unsigned int, QMap< QString, QString > >& fields )
+{
+    m_fuzzyIndex->updateFields( fields );
+}
+
+
+void
+DatabaseImpl::removeFromSearchIndex( const QList< unsigned int >& trackIds, const QList< unsigned int >& albumIds, const QList< unsigned int >& artistIds )
+{
+    m_fuzzyIndex->deleteFields( trackIds, albumIds, artistIds );
+}
+
+
+void
+DatabaseImpl::mergeSearchIndex()
+{
+    m_fuzzyIndex->mergeIndex();
 }
 
 
@@ -495,7 +856,27 @@ DatabaseImpl::getTrackFids( int tid )
 QString
 DatabaseImpl::sortname( const QString& str, bool replaceArticle )
 {
-    QString s = str.toLower().trimmed().replace( QRegExp( "[\\s]{2,}" ), " " );
+    QString s;
+    bool interned = false;
+    {
+        QMutexLocker lock( &s_sortnamesMutex );
+        QHash< QString, QString >::const_iterator it = s_sortnames.constFind( str );
+        if ( it != s_sortnames.constEnd() )
+        {
+            s = it.value();
+            interned = true;
+        }
+    }
+
+    if ( !interned )
+    {
+        s = normalizedSortname( str );
+
+        QMutexLocker lock( &s_sortnamesMutex );
+        if ( s_sortnames.count() >= MAX_INTERNED_SORTNAMES )
+            s_sortnames.clear();
+        s_sortnames.insert( str, s );
+    }
 
     if ( replaceArticle && s.startsWith( "the " ) )
     {
@@ -506,6 +887,54 @@ DatabaseImpl::sortname( const QString& str, bool replaceArticle )
 }
 
 
+QString
+DatabaseImpl::normalizedSortname( const QString& str )
+{
+    // lower case, trimmed, and runs of whitespace collapsed into a single space
+    const QString lower = str.toLower();
+    const QChar* data = lower.constData();
+
+    int begin = 0;
+    int end = lower.length();
+    while ( begin < end && data[ begin ].isSpace() )
+        begin++;
+    while ( end > begin && data[ end - 1 ].isSpace() )
+        end--;
+
+    bool needsCollapsing = false;
+    for ( int i = begin + 1; i < end && !needsCollapsing; i++ )
+        needsCollapsing = data[ i ].isSpace() && data[ i - 1 ].isSpace();
+
+    if ( !needsCollapsing )
+    {
+        // most names are fine already, so just share the data
+        if ( begin == 0 && end == lower.length() )
+            return lower;
+
+        return lower.mid( begin, end - begin );
+    }
+
+    QString s;
+    s.reserve( end - begin );
+    for ( int i = begin; i < end; i++ )
+    {
+        // a single whitespace character is kept as it is, only runs are collapsed
+        if ( data[ i ].isSpace() && data[ i + 1 ].isSpace() )
+        {
+            while ( data[ i + 1 ].isSpace() )
+                i++;
+
+            s += QChar( ' ' );
+            continue;
+        }
+
+        s += data[ i ];
+    }
+
+    return s;
+}
+
+
 QVariantMap
 DatabaseImpl::artist( int id )
 {
@@ -559,6 +988,37 @@ DatabaseImpl::album( int id )
 }
 
 
+void
+DatabaseImpl::loadTrackAttributes( const QList< Tomahawk::result_ptr >& results )
+{
+    QHash< unsigned int, QVariantMap > attributes;
+    QStringList trackIds;
+    foreach ( const Tomahawk::result_ptr& result, results )
+    {
+        if ( !attributes.contains( result->trackId() ) )
+        {
+            attributes.insert( result->trackId(), QVariantMap() );
+            trackIds << QString::number( result->trackId() );
+        }
+    }
+
+    for ( int i = 0; i < trackIds.count(); i += TRACK_ATTRIBUTES_BATCH )
+    {
+        TomahawkSqlQuery query = newquery();
+        query.exec( QString( "SELECT id, k, v FROM track_attributes WHERE id IN (%1)" )
+                       .arg( QStringList( trackIds.mid( i, TRACK_ATTRIBUTES_BATCH ) ).join( "," ) ) );
+
+        while ( query.next() )
+        {
+            attributes[ query.value( 0 ).toUInt() ][ query.value( 1 ).toString() ] = query.value( 2 ).toString();
+        }
+    }
+
+    foreach ( const Tomahawk::result_ptr& result, results )
+        result->setAttributes( attributes.value( result->trackId() ) );
+}
+
+
 Tomahawk::result_ptr
 DatabaseImpl::resultFromHint( const Tomahawk::query_ptr& origquery )
 {
@@ -702,6 +1162,11 @@ DatabaseImpl::openDatabase( const QString& dbname )
             tLog() << "Database schema of" << dbname << "is" << version;
         }
 
+        // the backup made before migrating only copies the database file, so move
+        // everything from the write-ahead log into it first
+        if ( version > 0 && version != CURRENT_SCHEMA_VERSION )
+            qry.exec( "PRAGMA wal_checkpoint(FULL)" );
+
         if ( version < 0 || version == CURRENT_SCHEMA_VERSION )
             m_db = db;
     }
@@ -718,6 +1183,10 @@ DatabaseImpl::openDatabase( const QString& dbname )
         tLog() << endl << "****************************" << endl;
 
         QFile::copy( dbname, newname );
+        // whatever the checkpoint couldn't move, sqlite picks the log up next to the copy.
+        // The -shm index gets rebuilt from it
+        if ( QFileInfo( dbname + "-wal" ).size() > 0 )
+            QFile::copy( dbname + "-wal", newname + "-wal" );
         {
             m_db = QSqlDatabase::addDatabase( "QSQLITE", "tomahawk" );
             m_db.setDatabaseName( dbname );
@@ -29,36 +29,75 @@
 #include <QSqlError>
 #include <QSqlQuery>
 #include <QHash>
+#include <QStringList>
+#include <QCache>
 #include <QThread>
 
 #include "TomahawkSqlQuery.h"
 #include "FuzzyIndex.h"
 #include "Typedefs.h"
 
+#include "DllMacro.h"
+
 class Database;
 
-class DatabaseImpl : public QObject
+class DLLEXPORT DatabaseImpl : public QObject
 {
 Q_OBJECT
 
 friend class FuzzyIndex;
 friend class DatabaseCommand_UpdateSearchIndex;
+friend class TomahawkSqlQuery;
 
 public:
-    DatabaseImpl( const QString& dbname, Database* parent = 0 );
+    // trigramIndex: search with a TrigramIndex instead of Lucene
+    DatabaseImpl( const QString& dbname, bool trigramIndex, Database* parent = 0 );
     ~DatabaseImpl();
 
     bool openDatabase( const QString& dbname );
 
-    TomahawkSqlQuery newquery() { return TomahawkSqlQuery( m_db ); }
+    // opens another connection to the same database. It may only be used by
+    // the thread that called clone(), and shares the search index with us.
+    // Returns 0 if the connection can't be opened
+    DatabaseImpl* clone( bool readOnly ) const;
+    bool isReadOnly() const { return m_readOnly; }
+
+    TomahawkSqlQuery newquery() { return TomahawkSqlQuery( m_db, this ); }
     QSqlDatabase& database() { return m_db; }
 
     int artistId( const QString& name_orig, bool autoCreate ); //also for composers!
     int trackId( int artistid, const QString& name_orig, bool autoCreate );
     int albumId( int artistid, const QString& name_orig, bool autoCreate );
 
+    // same as above for many names at once. Only names that aren't cached yet get looked up,
+    // in batches. Names that can't be resolved are missing from the result
+    QHash< QString, int > artistIds( const QStringList& names, bool autoCreate );
+    QHash< QPair<int, QString>, int > trackIds( const QList< QPair<int, QString> >& tracks, bool autoCreate );
+    QHash< QPair<int, QString>, int > albumIds( const QList< QPair<int, QString> >& albums, bool autoCreate );
+
+    // inserts values.count() / columns rows, with as few statements as possible.
+    // insert is the statement without its values, e.g. "INSERT INTO foo(a, b)"
+    bool insertRows( const QString& insert, int columns, const QVariantList& values );
+
+    // ids cached during a transaction are forgotten again if it gets rolled back,
+    // so mutating commands have to use these instead of the ones of database()
+    bool transaction();
+    bool commit();
+    void rollback();
+    // call after rolling back to a savepoint
+    void discardUncommittedIds();
+
     QList< QPair<int, float> > search( const Tomahawk::query_ptr& query, uint limit = 0 );
-    QList< QPair<int, float> > searchAlbum( const Tomahawk::query_ptr& query, uint limit = 0 );
+    QList< QList< QPair<int, float> > > search( const QList< Tomahawk::query_ptr >& queries, uint limit = 0 );
+    // best match first, straight from the search index
+    QList< Tomahawk::artist_ptr > searchArtists( const QString& text, uint limit = 0 );
+    QList< Tomahawk::album_ptr > searchAlbums( const QString& text, uint limit = 0 );
+
+    // keep the search index in sync with added and removed tracks, albums & artists, without a rebuild.
+    // fields are keyed by track, album or artist id, see FuzzyIndex::appendFields()
+    void updateSearchIndex( const QMap< unsigned int, QMap< QString, QString > >& fields );
+    void removeFromSearchIndex( const QList< unsigned int >& trackIds, const QList< unsigned int >& albumIds, const QList< unsigned int >& artistIds );
+    void mergeSearchIndex();
     QList< int > getTrackFids( int tid );
 
     static QString sortname( const QString& str, bool replaceArticle = false );
@@ -68,6 +107,8 @@ public:
     QVariantMap track( int id );
     Tomahawk::result_ptr file( int fid );
     Tomahawk::result_ptr resultFromHint( const Tomahawk::query_ptr& query );
+    // sets the track attributes of all results, with one query per batch of tracks
+    void loadTrackAttributes( const QList< Tomahawk::result_ptr >& results );
 
     static bool scorepairSorter( const QPair<int,float>& left, const QPair<int,float>& right )
     {
@@ -85,18 +126,53 @@ private slots:
     void updateIndex();
 
 private:
+    DatabaseImpl( const QString& dbname, const QString& dbid, FuzzyIndex* fuzzyIndex, bool readOnly );
+
+    static QString normalizedSortname( const QString& str );
+
+    int childId( const QString& table, QCache< QString, int >& cache, QStringList& uncommitted,
+                 int artistid, const QString& name_orig, bool autoCreate );
+    QHash< QPair<int, QString>, int > childIds( const QString& table, QCache< QString, int >& cache, QStringList& uncommitted,
+                                                const QList< QPair<int, QString> >& children, bool autoCreate );
+    // these move what they found from missing to ids
+    void lookupArtistIds( QHash< QString, QStringList >& missing, QHash< QString, int >& ids );
+    void lookupChildIds( const QString& table, QCache< QString, int >& cache, QStringList& uncommitted,
+                         QHash< QString, QList< QPair<int, QString> > >& missing, QHash< QPair<int, QString>, int >& ids );
+    void cacheId( QCache< QString, int >& cache, QStringList& uncommitted, const QString& key, int id );
+
+    // removes a prepared statement for sql from the cache while it's in use, 0 if there is none
+    QSqlQuery* takeStatement( const QString& sql );
+    void returnStatement( const QString& sql, const QSqlQuery& query );
+    void logStatementStats() const;
+
     QString cleanSql( const QString& sql );
     bool updateSchema( int oldVersion );
     void dumpDatabase();
 
     bool m_ready;
     QSqlDatabase m_db;
-
-    QString m_lastart, m_lastalb, m_lasttrk;
-    int m_lastartid, m_lastalbid, m_lasttrkid;
+    QString m_dbname;
+    QString m_connectionName;
+    bool m_readOnly;
+    bool m_isClone;
+
+    // artist ids by sortname, track and album ids by artist id and sortname
+    QCache< QString, int > m_artistIds;
+    QCache< QString, int > m_trackIds;
+    QCache< QString, int > m_albumIds;
+    // what got cached since the current transaction began
+    bool m_inTransaction;
+    QStringList m_uncommittedArtistIds;
+    QStringList m_uncommittedTrackIds;
+    QStringList m_uncommittedAlbumIds;
 
     QString m_dbid;
     FuzzyIndex* m_fuzzyIndex;
+
+    // prepared statements of this connection by their SQL, least recently used ones get dropped
+    QCache< QString, QSqlQuery > m_statements;
+    unsigned int m_statementHits;
+    unsigned int m_statementMisses;
 };
 
 #endif // DATABASEIMPL_H
@@ -37,8 +37,21 @@ DatabaseResolver::DatabaseResolver( int weight )
 void
 DatabaseResolver::resolve( const Tomahawk::query_ptr& query )
 {
-    DatabaseCommand_Resolve* cmd = new DatabaseCommand_Resolve( query );
+    enqueue( new DatabaseCommand_Resolve( query ) );
+}
+
+
+void
+DatabaseResolver::resolve( const QList< Tomahawk::query_ptr >& queries )
+{
+    // a single command answers the whole batch
+    enqueue( new DatabaseCommand_Resolve( queries ) );
+}
+
 
+void
+DatabaseResolver::enqueue( DatabaseCommand_Resolve* cmd )
+{
     connect( cmd, SIGNAL( results( Tomahawk::QID, QList< Tomahawk::result_ptr > ) ),
                     SLOT( gotResults( Tomahawk::QID, QList< Tomahawk::result_ptr > ) ), Qt::QueuedConnection );
     connect( cmd, SIGNAL( albums( Tomahawk::QID, QList< Tomahawk::album_ptr > ) ),
@@ -47,7 +60,6 @@ DatabaseResolver::resolve( const Tomahawk::query_ptr& query )
                     SLOT( gotArtists( Tomahawk::QID, QList< Tomahawk::artist_ptr > ) ), Qt::QueuedConnection );
 
     Database::instance()->enqueue( QSharedPointer<DatabaseCommand>( cmd ) );
-
 }
 
 
@@ -56,7 +68,7 @@ DatabaseResolver::gotResults( const Tomahawk::QID qid, QList< Tomahawk::result_p
 {
     qDebug() << Q_FUNC_INFO << qid << results.length();
 
-    Tomahawk::Pipeline::instance()->reportResults( qid, results );
+    Tomahawk::Pipeline::instance()->reportResults( qid, this, results );
 }
 
 
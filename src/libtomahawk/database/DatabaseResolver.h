@@ -26,6 +26,8 @@
 
 #include "DllMacro.h"
 
+class DatabaseCommand_Resolve;
+
 class DLLEXPORT DatabaseResolver : public Tomahawk::Resolver
 {
 Q_OBJECT
@@ -40,6 +42,7 @@ public:
 
 public slots:
     virtual void resolve( const Tomahawk::query_ptr& query );
+    virtual void resolve( const QList< Tomahawk::query_ptr >& queries );
 
 private slots:
     void gotResults( const Tomahawk::QID qid, QList< Tomahawk::result_ptr> results );
@@ -47,6 +50,8 @@ private slots:
     void gotArtists( const Tomahawk::QID qid, QList< Tomahawk::artist_ptr> artists );
 
 private:
+    void enqueue( DatabaseCommand_Resolve* cmd );
+
     int m_weight;
 };
 
@@ -34,14 +34,18 @@
     //#define DEBUG_TIMING TRUE
 #endif
 
+// how long the first of a burst of groupable commands waits for the rest of it (in ms)
+#define GROUP_COMMIT_WINDOW 20
+// how many commands may at most share one transaction
+#define MAX_GROUPED_COMMANDS 100
+
 DatabaseWorker::DatabaseWorker( DatabaseImpl* lib, Database* db, bool mutates )
     : QThread()
+    , m_db( db )
     , m_dbimpl( lib )
+    , m_mutates( mutates )
     , m_outstanding( 0 )
 {
-    Q_UNUSED( db );
-    Q_UNUSED( mutates );
-
     moveToThread( this );
 
     qDebug() << "CTOR DatabaseWorker" << this->thread();
@@ -68,8 +72,55 @@ DatabaseWorker::~DatabaseWorker()
 void
 DatabaseWorker::run()
 {
+    // sqlite connections must only be used by the thread that opened them,
+    // so every worker opens its own. Read workers can't write through theirs
+    DatabaseImpl* impl = m_dbimpl->clone( !m_mutates );
+    m_dbimpl = impl;
+    if ( impl )
+        m_db->setThreadImpl( impl );
+    else
+        tLog() << Q_FUNC_INFO << "Can't open a database connection, the commands of this worker get dropped";
+
     exec();
     qDebug() << Q_FUNC_INFO << "DatabaseWorker finishing...";
+
+    if ( impl )
+    {
+        m_db->setThreadImpl( 0 );
+        delete impl;
+    }
+}
+
+
+unsigned int
+DatabaseWorker::jobsAhead( DatabaseCommand::Priority priority )
+{
+    QMutexLocker lock( &m_mut );
+
+    // the job currently running isn't in m_commands anymore
+    unsigned int ahead = m_outstanding - m_commands.count();
+    foreach ( const QSharedPointer<DatabaseCommand>& cmd, m_commands )
+    {
+        if ( m_mutates || cmd->priority() <= priority )
+            ahead++;
+    }
+
+    return ahead;
+}
+
+
+void
+DatabaseWorker::insertCommand( const QSharedPointer<DatabaseCommand>& cmd )
+{
+    int i = m_commands.count();
+    if ( !m_mutates )
+    {
+        // behind everything of the same or a more urgent priority
+        while ( i > 0 && m_commands.at( i - 1 )->priority() > cmd->priority() )
+            i--;
+    }
+
+    m_commands.insert( i, cmd );
 }
 
 
@@ -78,7 +129,8 @@ DatabaseWorker::enqueue( const QList< QSharedPointer<DatabaseCommand> >& cmds )
 {
     QMutexLocker lock( &m_mut );
     m_outstanding += cmds.count();
-    m_commands << cmds;
+    foreach ( const QSharedPointer<DatabaseCommand>& cmd, cmds )
+        insertCommand( cmd );
 
     if ( m_outstanding == cmds.count() )
         QTimer::singleShot( 0, this, SLOT( doWork() ) );
@@ -90,10 +142,11 @@ DatabaseWorker::enqueue( const QSharedPointer<DatabaseCommand>& cmd )
 {
     QMutexLocker lock( &m_mut );
     m_outstanding++;
-    m_commands << cmd;
+    insertCommand( cmd );
 
+    // give a burst of groupable commands the chance to arrive, so they can share a single commit
     if ( m_outstanding == 1 )
-        QTimer::singleShot( 0, this, SLOT( doWork() ) );
+        QTimer::singleShot( cmd->groupable() ? GROUP_COMMIT_WINDOW : 0, this, SLOT( doWork() ) );
 }
 
 
@@ -102,6 +155,11 @@ DatabaseWorker::doWork()
 {
     /*
         Run the dbcmd. Only inside a transaction if the cmd does mutates.
+        Read-only commands that got canceled while queued are skipped.
+
+        Consecutive groupable commands share one transaction, up to
+        MAX_GROUPED_COMMANDS of them. Each command runs inside a savepoint,
+        so a failing command only rolls back its own changes.
 
         If the cmd is modifying local content (ie source->isLocal()) then
         log to the database oplog for replication to peers.
@@ -114,101 +172,144 @@ DatabaseWorker::doWork()
 #endif
 
     QList< QSharedPointer<DatabaseCommand> > cmdGroup;
+    QList< QSharedPointer<DatabaseCommand> > succeeded;
     QSharedPointer<DatabaseCommand> cmd;
     {
         QMutexLocker lock( &m_mut );
         cmd = m_commands.takeFirst();
     }
 
-    if ( cmd->doesMutates() )
+    // there's nothing to run it on. It still finishes, like a canceled command, so nobody waits forever
+    if ( !m_dbimpl )
     {
-        bool transok = m_dbimpl->database().transaction();
+        tLog() << "No database connection, dropping db command:" << cmd->commandname() << cmd->guid();
+        cmd->emitFinished();
+
+        QMutexLocker lock( &m_mut );
+        m_outstanding--;
+        if ( m_outstanding > 0 )
+            QTimer::singleShot( 0, this, SLOT( doWork() ) );
+        return;
+    }
+
+    const bool mutates = cmd->doesMutates();
+    if ( mutates )
+    {
+        bool transok = m_dbimpl->transaction();
         Q_ASSERT( transok );
         Q_UNUSED( transok );
     }
 
-    unsigned int completed = 0;
     try
     {
-        bool finished = false;
+        while ( true )
         {
-            while ( !finished )
-            {
-                completed++;
-                cmd->_exec( m_dbimpl ); // runs actual SQL stuff
+            cmdGroup << cmd;
+            if ( !mutates && cmd->isCanceled() )
+                tDebug( LOGVERBOSE ) << "Skipping canceled db command:" << cmd->commandname() << cmd->guid();
+            else if ( execCommand( cmd, mutates ) )
+                succeeded << cmd;
 
-                if ( cmd->loggable() )
-                {
-                    // We only save our own ops to the oplog, since incoming ops from peers
-                    // are applied immediately.
-                    //
-                    // Crazy idea: if peers had keypairs and could sign ops/msgs, in theory it
-                    // would be safe to sync ops for friend A from friend B's cache, if he saved them,
-                    // which would mean you could get updates even if a peer was offline.
-                    if ( cmd->source()->isLocal() && !cmd->localOnly() )
-                    {
-                        // save to op-log
-                        DatabaseCommandLoggable* command = (DatabaseCommandLoggable*)cmd.data();
-                        logOp( command );
-                    }
-                    else
-                    {
-                        // Make a note of the last guid we applied for this source
-                        // so we can always request just the newer ops in future.
-                        //
-                        if ( !cmd->singletonCmd() )
-                        {
-                            TomahawkSqlQuery query = m_dbimpl->newquery();
-                            query.prepare( "UPDATE source SET lastop = ? WHERE id = ?" );
-                            query.addBindValue( cmd->guid() );
-                            query.addBindValue( cmd->source()->id() );
-
-                            if ( !query.exec() )
-                            {
-                                throw "Failed to set lastop";
-                            }
-                        }
-                    }
-                }
+            if ( !cmd->groupable() || cmdGroup.count() >= MAX_GROUPED_COMMANDS )
+                break;
 
-                cmdGroup << cmd;
-                if ( cmd->groupable() && !m_commands.isEmpty() )
-                {
-                    QMutexLocker lock( &m_mut );
-                    if ( m_commands.first()->groupable() )
-                    {
-                        cmd = m_commands.takeFirst();
-                    }
-                    else
-                    {
-                        finished = true;
-                    }
-                }
-                else
-                    finished = true;
-            }
+            QMutexLocker lock( &m_mut );
+            if ( m_commands.isEmpty() || !m_commands.first()->groupable() )
+                break;
+
+            cmd = m_commands.takeFirst();
+        }
 
-            if ( cmd->doesMutates() )
+        if ( mutates )
+        {
+            qDebug() << "Committing" << cmdGroup.count() << "commands, last one:" << cmd->commandname() << cmd->guid();
+            if ( !m_dbimpl->commit() )
             {
-                qDebug() << "Committing" << cmd->commandname() << cmd->guid();
-                if ( !m_dbimpl->database().commit() )
-                {
-                    tDebug() << "FAILED TO COMMIT TRANSACTION*";
-                    throw "commit failed";
-                }
+                tLog() << "*ERROR* committing transaction:"
+                       << m_dbimpl->database().lastError().databaseText()
+                       << m_dbimpl->database().lastError().driverText();
+
+                m_dbimpl->rollback();
+                succeeded.clear();
+                Q_ASSERT( false );
             }
+        }
 
 #ifdef DEBUG_TIMING
-            uint duration = timer.elapsed();
-            tDebug() << "DBCmd Duration:" << duration << "ms, now running postcommit for" << cmd->commandname();
+        uint duration = timer.elapsed();
+        tDebug() << "DBCmd Duration:" << duration << "ms, now running postcommit for" << succeeded.count() << "commands";
 #endif
 
-            foreach ( QSharedPointer<DatabaseCommand> c, cmdGroup )
-                c->postCommit();
+        foreach ( QSharedPointer<DatabaseCommand> c, succeeded )
+            c->postCommit();
 
 #ifdef DEBUG_TIMING
-            tDebug() << "Post commit finished in" << timer.elapsed() - duration << "ms for" << cmd->commandname();
+        tDebug() << "Post commit finished in" << timer.elapsed() - duration << "ms";
 #endif
+    }
+    catch(...)
+    {
+        qDebug() << "Uncaught exception processing dbcmd";
+        if ( mutates )
+            m_dbimpl->rollback();
+
+        Q_ASSERT( false );
+        throw;
+    }
+
+    foreach ( QSharedPointer<DatabaseCommand> c, cmdGroup )
+        c->emitFinished();
+
+    QMutexLocker lock( &m_mut );
+    m_outstanding -= cmdGroup.count();
+    if ( m_outstanding > 0 )
+        QTimer::singleShot( 0, this, SLOT( doWork() ) );
+}
+
+
+bool
+DatabaseWorker::execCommand( const QSharedPointer<DatabaseCommand>& cmd, bool savepoint )
+{
+    TomahawkSqlQuery savepointQuery = m_dbimpl->newquery();
+    if ( savepoint )
+        savepointQuery.exec( "SAVEPOINT dbcmd" );
+
+    try
+    {
+        cmd->_exec( m_dbimpl ); // runs actual SQL stuff
+
+        if ( cmd->loggable() )
+        {
+            // We only save our own ops to the oplog, since incoming ops from peers
+            // are applied immediately.
+            //
+            // Crazy idea: if peers had keypairs and could sign ops/msgs, in theory it
+            // would be safe to sync ops for friend A from friend B's cache, if he saved them,
+            // which would mean you could get updates even if a peer was offline.
+            if ( cmd->source()->isLocal() && !cmd->localOnly() )
+            {
+                // save to op-log
+                DatabaseCommandLoggable* command = (DatabaseCommandLoggable*)cmd.data();
+                logOp( command );
+            }
+            else
+            {
+                // Make a note of the last guid we applied for this source
+                // so we can always request just the newer ops in future.
+                //
+                if ( !cmd->singletonCmd() )
+                {
+                    TomahawkSqlQuery query = m_dbimpl->newquery();
+                    query.prepare( "UPDATE source SET lastop = ? WHERE id = ?" );
+                    query.addBindValue( cmd->guid() );
+                    query.addBindValue( cmd->source()->id() );
+
+                    if ( !query.exec() )
+                    {
+                        throw "Failed to set lastop";
+                    }
+                }
+            }
         }
     }
     catch( const char * msg )
@@ -221,28 +322,22 @@ DatabaseWorker::doWork()
                  << m_dbimpl->database().lastError().driverText()
                  << endl;
 
-        if ( cmd->doesMutates() )
-            m_dbimpl->database().rollback();
-
-        Q_ASSERT( false );
-    }
-    catch(...)
-    {
-        qDebug() << "Uncaught exception processing dbcmd";
-        if ( cmd->doesMutates() )
-            m_dbimpl->database().rollback();
+        // only undo what this command did, the rest of the group still gets committed
+        if ( savepoint )
+        {
+            savepointQuery.exec( "ROLLBACK TO SAVEPOINT dbcmd" );
+            savepointQuery.exec( "RELEASE SAVEPOINT dbcmd" );
+            m_dbimpl->discardUncommittedIds();
+        }
 
         Q_ASSERT( false );
-        throw;
+        return false;
     }
 
-    foreach ( QSharedPointer<DatabaseCommand> c, cmdGroup )
-        c->emitFinished();
+    if ( savepoint )
+        savepointQuery.exec( "RELEASE SAVEPOINT dbcmd" );
 
-    QMutexLocker lock( &m_mut );
-    m_outstanding -= completed;
-    if ( m_outstanding > 0 )
-        QTimer::singleShot( 0, this, SLOT( doWork() ) );
+    return true;
 }
 
 
@@ -44,6 +44,8 @@ public:
 
     bool busy() const { return m_outstanding > 0; }
     unsigned int outstandingJobs() const { return m_outstanding; }
+    // how many jobs would run before a newly enqueued command of this priority
+    unsigned int jobsAhead( DatabaseCommand::Priority priority );
 
 public slots:
     void enqueue( const QSharedPointer<DatabaseCommand>& );
@@ -56,10 +58,16 @@ private slots:
     void doWork();
 
 private:
+    // read workers keep m_commands sorted by priority, the RW worker preserves the order of its commands
+    void insertCommand( const QSharedPointer<DatabaseCommand>& cmd );
+    // returns false if the command failed, its changes are undone then
+    bool execCommand( const QSharedPointer<DatabaseCommand>& cmd, bool savepoint );
     void logOp( DatabaseCommandLoggable* command );
 
     QMutex m_mut;
+    Database* m_db;
     DatabaseImpl* m_dbimpl;
+    bool m_mutates;
     QList< QSharedPointer<DatabaseCommand> > m_commands;
     int m_outstanding;
 
@@ -18,13 +18,18 @@
 
 #include "FuzzyIndex.h"
 
+#include <algorithm>
+
 #include <QDir>
 #include <QTime>
+#include <QVector>
 
 #include <CLucene.h>
 #include <CLucene/queryParser/MultiFieldQueryParser.h>
 
+#include "Database.h"
 #include "DatabaseImpl.h"
+#include "DatabaseCommand_MergeSearchIndex.h"
 #include "utils/TomahawkUtils.h"
 #include "utils/Logger.h"
 #include "Source.h"
@@ -37,17 +42,183 @@ using namespace lucene::index;
 using namespace lucene::queryParser;
 using namespace lucene::search;
 
+// incremental changes get merged at most this often, in ms
+#define MERGE_INTERVAL 10 * 60 * 1000
+// separates the values the trigram index stores with an album
+#define STORED_SEPARATOR QChar( 0x1f )
+// names starting with a shorter prefix would be most of the index
+#define MIN_PREFIX_LENGTH 2
+// a prefix search stops after this many documents per result asked for,
+// or after MAX_PREFIX_CANDIDATES if there is no limit
+#define PREFIX_CANDIDATES_PER_RESULT 10
+#define MAX_PREFIX_CANDIDATES 1000
+
+
+// how many documents the prefix search of a name may look at
+static uint
+prefixCandidates( const QString& name, uint limit )
+{
+    if ( name.length() < MIN_PREFIX_LENGTH )
+        return 0;
+
+    return limit ? limit * PREFIX_CANDIDATES_PER_RESULT : MAX_PREFIX_CANDIDATES;
+}
+
+
+// deleter of the searcher snapshots, runs once the last search using one is done
+static void
+closeSnapshot( IndexSearcher* searcher )
+{
+    try
+    {
+        IndexReader* reader = searcher->getReader();
+        searcher->close();
+        reader->close();
+
+        delete searcher;
+        delete reader;
+    }
+    catch( CLuceneError& error )
+    {
+        tDebug() << "Caught CLucene error:" << error.what();
+    }
+}
+
+
+/*
+    Keeps the best scores seen so far in a min-heap of at most limit entries,
+    so only those have to be sorted in the end. A limit of 0 keeps all of them.
+*/
+class TopScores
+{
+public:
+    explicit TopScores( uint limit ) : m_limit( limit ) {}
+
+    // false if the heap is full and score wouldn't replace its lowest one
+    bool accepts( float score ) const
+    {
+        return !m_limit || (uint)m_heap.count() < m_limit || score > m_heap.first().second;
+    }
+
+    void insert( int id, float score )
+    {
+        if ( !accepts( score ) )
+            return;
+
+        if ( m_limit && (uint)m_heap.count() == m_limit )
+        {
+            std::pop_heap( m_heap.begin(), m_heap.end(), DatabaseImpl::scorepairSorter );
+            m_heap.last() = QPair< int, float >( id, score );
+        }
+        else
+            m_heap << QPair< int, float >( id, score );
+
+        std::push_heap( m_heap.begin(), m_heap.end(), DatabaseImpl::scorepairSorter );
+    }
+
+    // best score first
+    QList< QPair< int, float > > sorted()
+    {
+        std::sort_heap( m_heap.begin(), m_heap.end(), DatabaseImpl::scorepairSorter );
+        return m_heap.toList();
+    }
+
+private:
+    uint m_limit;
+    QVector< QPair< int, float > > m_heap;
+};
+
+
+// parses the stored trackid / albumid of a document, without copying it into a QString first
+static int
+documentId( const TCHAR* value )
+{
+    int id = 0;
+    for ( ; value && *value >= '0' && *value <= '9'; value++ )
+        id = id * 10 + ( *value - '0' );
+
+    return id;
+}
+
+
+static QString
+storedString( Document& doc, const TCHAR* field )
+{
+    const TCHAR* value = doc.get( field );
+    return value ? QString::fromWCharArray( value ) : QString();
+}
+
+
+// the field that identifies the document of a track, album or artist, see appendFields()
+static const TCHAR*
+idField( const QMap< QString, QString >& values )
+{
+    if ( values.contains( "track" ) )
+        return _T( "trackid" );
+    if ( values.contains( "album" ) )
+        return _T( "albumid" );
+
+    return _T( "artistid" );
+}
+
 
-FuzzyIndex::FuzzyIndex( DatabaseImpl& db, bool wipeIndex )
+static QList< TrigramIndex::Entry >
+trigramEntries( const QMap< unsigned int, QMap< QString, QString > >& trackData )
+{
+    QList< TrigramIndex::Entry > entries;
+
+    QMapIterator< unsigned int, QMap< QString, QString > > it( trackData );
+    while ( it.hasNext() )
+    {
+        it.next();
+        const int id = it.key();
+        const QMap< QString, QString >& values = it.value();
+
+        // the same values as the Lucene documents get
+        if ( values.contains( "track" ) )
+        {
+            entries << TrigramIndex::Entry( TrigramIndex::TrackField, DatabaseImpl::sortname( values.value( "track" ) ), id )
+                    << TrigramIndex::Entry( TrigramIndex::ArtistField, DatabaseImpl::sortname( values.value( "artist" ) ), id )
+                    << TrigramIndex::Entry( TrigramIndex::FullTextField, DatabaseImpl::sortname( QString( "%1 %2" ).arg( values.value( "artist" ) ).arg( values.value( "track" ) ) ), id );
+        }
+        else if ( values.contains( "album" ) )
+        {
+            const QStringList stored = QStringList() << values.value( "album" ) << values.value( "artistid" ) << values.value( "artist" );
+            entries << TrigramIndex::Entry( TrigramIndex::AlbumField, DatabaseImpl::sortname( values.value( "album" ) ), id,
+                                            stored.join( STORED_SEPARATOR ) );
+        }
+        else if ( values.contains( "artist" ) )
+        {
+            entries << TrigramIndex::Entry( TrigramIndex::ArtistNameField, DatabaseImpl::sortname( values.value( "artist" ) ), id, values.value( "artist" ) );
+        }
+        else
+            Q_ASSERT( false );
+    }
+
+    return entries;
+}
+
+
+FuzzyIndex::FuzzyIndex( DatabaseImpl& db, bool trigramIndex, bool wipeIndex )
     : QObject()
     , m_db( db )
-    , m_luceneReader( 0 )
-    , m_luceneSearcher( 0 )
+    , m_trigramIndex( 0 )
+    , m_pendingChanges( 0 )
 {
-    QString m_lucenePath = TomahawkUtils::appDataDir().absoluteFilePath( "tomahawk.lucene" );
+    m_lucenePath = TomahawkUtils::appDataDir().absoluteFilePath( "tomahawk.lucene" );
     m_luceneDir = FSDirectory::getDirectory( m_lucenePath.toStdString().c_str() );
     m_analyzer = _CLNEW SimpleAnalyzer();
 
+    if ( trigramIndex )
+    {
+        tLog() << "Using the trigram search index";
+        m_trigramIndex = new TrigramIndex( TomahawkUtils::appDataDir().absoluteFilePath( "tomahawk.trigram" ) );
+    }
+
+    m_mergeTimer.setSingleShot( true );
+    m_mergeTimer.setInterval( MERGE_INTERVAL );
+    connect( &m_mergeTimer, SIGNAL( timeout() ), SLOT( onMergeTimeout() ) );
+
     if ( wipeIndex )
     {
         tLog( LOGVERBOSE ) << "Wiping fuzzy index...";
@@ -59,32 +230,38 @@ FuzzyIndex::FuzzyIndex( DatabaseImpl& db, bool wipeIndex )
 
 FuzzyIndex::~FuzzyIndex()
 {
-    delete m_luceneSearcher;
-    delete m_luceneReader;
+    m_searcher.clear();
+    delete m_trigramIndex;
     delete m_analyzer;
     delete m_luceneDir;
 }
 
 
+bool
+FuzzyIndex::indexExists() const
+{
+    if ( m_trigramIndex )
+        return m_trigramIndex->exists();
+
+    return IndexReader::indexExists( m_lucenePath.toStdString().c_str() );
+}
+
+
 void
 FuzzyIndex::beginIndexing()
 {
-    m_mutex.lock();
+    m_writeMutex.lock();
+
+    if ( m_trigramIndex )
+    {
+        m_trigramEntries.clear();
+        return;
+    }
 
     try
     {
+        // searches keep using the current snapshot until the new index is complete
         qDebug() << Q_FUNC_INFO << "Starting indexing.";
-        if ( m_luceneReader != 0 )
-        {
-            qDebug() << "Deleting old lucene stuff.";
-            m_luceneSearcher->close();
-            m_luceneReader->close();
-            delete m_luceneSearcher;
-            delete m_luceneReader;
-            m_luceneSearcher = 0;
-            m_luceneReader = 0;
-        }
-
         qDebug() << "Creating new index writer.";
         IndexWriter luceneWriter( m_luceneDir, m_analyzer, true );
     }
@@ -99,7 +276,32 @@ FuzzyIndex::beginIndexing()
 void
 FuzzyIndex::endIndexing()
 {
-    m_mutex.unlock();
+    if ( m_trigramIndex )
+    {
+        m_trigramIndex->reset( m_trigramEntries );
+        m_trigramEntries.clear();
+
+        m_pendingChanges = 0;
+        m_writeMutex.unlock();
+        emit indexReady();
+        return;
+    }
+
+    try
+    {
+        IndexWriter luceneWriter( m_luceneDir, m_analyzer, false );
+        luceneWriter.optimize();
+        luceneWriter.close();
+    }
+    catch( CLuceneError& error )
+    {
+        qDebug() << "Caught CLucene error:" << error.what();
+        Q_ASSERT( false );
+    }
+
+    m_pendingChanges = 0;
+    refreshSearcher();
+    m_writeMutex.unlock();
     emit indexReady();
 }
 
@@ -107,52 +309,235 @@ FuzzyIndex::endIndexing()
 void
 FuzzyIndex::appendFields( const QMap< unsigned int, QMap< QString, QString > >& trackData )
 {
+    if ( m_trigramIndex )
+    {
+        m_trigramEntries << trigramEntries( trackData );
+        return;
+    }
+
     try
     {
         tDebug() << "Appending to index:" << trackData.count();
-        bool create = !IndexReader::indexExists( TomahawkUtils::appDataDir().absoluteFilePath( "tomahawk.lucene" ).toStdString().c_str() );
+        bool create = !IndexReader::indexExists( m_lucenePath.toStdString().c_str() );
         IndexWriter luceneWriter( m_luceneDir, m_analyzer, create );
-        Document doc;
 
-        QMapIterator< unsigned int, QMap< QString, QString > > it( trackData );
-        while ( it.hasNext() )
-        {
-            it.next();
-            unsigned int id = it.key();
-            QMap< QString, QString > values = it.value();
+        addDocuments( luceneWriter, trackData );
+        luceneWriter.close();
+    }
+    catch( CLuceneError& error )
+    {
+        qDebug() << "Caught CLucene error:" << error.what();
+        Q_ASSERT( false );
+    }
+}
 
-            if ( values.contains( "track" ) )
-            {
-                doc.add( *( _CLNEW Field( _T( "fulltext" ), DatabaseImpl::sortname( QString( "%1 %2" ).arg( values.value( "artist" ) ).arg( values.value( "track" ) ) ).toStdWString().c_str(),
-                                          Field::STORE_NO | Field::INDEX_UNTOKENIZED ) ) );
 
-                doc.add( *( _CLNEW Field( _T( "track" ), DatabaseImpl::sortname( values.value( "track" ) ).toStdWString().c_str(),
-                                          Field::STORE_NO | Field::INDEX_UNTOKENIZED ) ) );
+void
+FuzzyIndex::updateFields( const QMap< unsigned int, QMap< QString, QString > >& trackData )
+{
+    if ( trackData.isEmpty() )
+        return;
 
-                doc.add( *( _CLNEW Field( _T( "artist" ), DatabaseImpl::sortname( values.value( "artist" ) ).toStdWString().c_str(),
-                                          Field::STORE_NO | Field::INDEX_UNTOKENIZED ) ) );
+    QMutexLocker lock( &m_writeMutex );
 
-                doc.add( *( _CLNEW Field( _T( "artistid" ), values.value( "artistid" ).toStdWString().c_str(),
-                                          Field::STORE_YES | Field::INDEX_NO ) ) );
+    if ( m_trigramIndex )
+    {
+        m_trigramIndex->update( trigramEntries( trackData ) );
+        indexChanged( trackData.count() );
+        return;
+    }
 
-                doc.add( *( _CLNEW Field( _T( "trackid" ), QString::number( id ).toStdWString().c_str(),
-                                          Field::STORE_YES | Field::INDEX_NO ) ) );
-            }
-            else if ( values.contains( "album" ) )
+    try
+    {
+        tDebug() << "Updating index:" << trackData.count();
+        bool create = !IndexReader::indexExists( m_lucenePath.toStdString().c_str() );
+        IndexWriter luceneWriter( m_luceneDir, m_analyzer, create );
+
+        if ( !create )
+        {
+            QMapIterator< unsigned int, QMap< QString, QString > > it( trackData );
+            while ( it.hasNext() )
             {
-                doc.add( *( _CLNEW Field( _T( "album" ), DatabaseImpl::sortname( values.value( "album" ) ).toStdWString().c_str(),
-                                          Field::STORE_NO | Field::INDEX_UNTOKENIZED ) ) );
+                it.next();
 
-                doc.add( *( _CLNEW Field( _T( "albumid" ), QString::number( id ).toStdWString().c_str(),
-                                          Field::STORE_YES | Field::INDEX_NO ) ) );
+                Term* term = _CLNEW Term( idField( it.value() ), QString::number( it.key() ).toStdWString().c_str() );
+                luceneWriter.deleteDocuments( term );
+                _CLDECDELETE( term );
             }
-            else
-                Q_ASSERT( false );
+        }
+
+        addDocuments( luceneWriter, trackData );
+        luceneWriter.close();
+    }
+    catch( CLuceneError& error )
+    {
+        qDebug() << "Caught CLucene error:" << error.what();
+        Q_ASSERT( false );
+    }
+
+    refreshSearcher();
+    indexChanged( trackData.count() );
+}
+
+
+void
+FuzzyIndex::deleteFields( const QList< unsigned int >& trackIds, const QList< unsigned int >& albumIds, const QList< unsigned int >& artistIds )
+{
+    if ( trackIds.isEmpty() && albumIds.isEmpty() && artistIds.isEmpty() )
+        return;
+
+    QMutexLocker lock( &m_writeMutex );
+    const unsigned int changes = trackIds.count() + albumIds.count() + artistIds.count();
+
+    if ( m_trigramIndex )
+    {
+        QList< int > tracks, albums, artists;
+        foreach ( unsigned int id, trackIds )
+            tracks << id;
+        foreach ( unsigned int id, albumIds )
+            albums << id;
+        foreach ( unsigned int id, artistIds )
+            artists << id;
+
+        m_trigramIndex->remove( tracks, albums, artists );
+        indexChanged( changes );
+        return;
+    }
+
+    if ( !IndexReader::indexExists( m_lucenePath.toStdString().c_str() ) )
+        return;
+
+    try
+    {
+        tDebug() << "Deleting from index:" << trackIds.count() << "tracks," << albumIds.count() << "albums," << artistIds.count() << "artists";
+        IndexWriter luceneWriter( m_luceneDir, m_analyzer, false );
 
-            luceneWriter.addDocument( &doc );
-            doc.clear();
+        foreach ( unsigned int id, trackIds )
+        {
+            Term* term = _CLNEW Term( _T( "trackid" ), QString::number( id ).toStdWString().c_str() );
+            luceneWriter.deleteDocuments( term );
+            _CLDECDELETE( term );
+        }
+        foreach ( unsigned int id, albumIds )
+        {
+            Term* term = _CLNEW Term( _T( "albumid" ), QString::number( id ).toStdWString().c_str() );
+            luceneWriter.deleteDocuments( term );
+            _CLDECDELETE( term );
+        }
+        foreach ( unsigned int id, artistIds )
+        {
+            Term* term = _CLNEW Term( _T( "artistid" ), QString::number( id ).toStdWString().c_str() );
+            luceneWriter.deleteDocuments( term );
+            _CLDECDELETE( term );
         }
 
+        luceneWriter.close();
+    }
+    catch( CLuceneError& error )
+    {
+        qDebug() << "Caught CLucene error:" << error.what();
+        Q_ASSERT( false );
+    }
+
+    refreshSearcher();
+    indexChanged( changes );
+}
+
+
+void
+FuzzyIndex::indexChanged( unsigned int changes )
+{
+    m_pendingChanges += changes;
+    QMetaObject::invokeMethod( this, "scheduleMerge", Qt::QueuedConnection );
+}
+
+
+void
+FuzzyIndex::addDocuments( IndexWriter& luceneWriter, const QMap< unsigned int, QMap< QString, QString > >& trackData )
+{
+    Document doc;
+
+    QMapIterator< unsigned int, QMap< QString, QString > > it( trackData );
+    while ( it.hasNext() )
+    {
+        it.next();
+        unsigned int id = it.key();
+        QMap< QString, QString > values = it.value();
+
+        if ( values.contains( "track" ) )
+        {
+            doc.add( *( _CLNEW Field( _T( "fulltext" ), DatabaseImpl::sortname( QString( "%1 %2" ).arg( values.value( "artist" ) ).arg( values.value( "track" ) ) ).toStdWString().c_str(),
+                                      Field::STORE_NO | Field::INDEX_UNTOKENIZED ) ) );
+
+            doc.add( *( _CLNEW Field( _T( "track" ), DatabaseImpl::sortname( values.value( "track" ) ).toStdWString().c_str(),
+                                      Field::STORE_NO | Field::INDEX_UNTOKENIZED ) ) );
+
+            doc.add( *( _CLNEW Field( _T( "artist" ), DatabaseImpl::sortname( values.value( "artist" ) ).toStdWString().c_str(),
+                                      Field::STORE_NO | Field::INDEX_UNTOKENIZED ) ) );
+
+            // indexed, so updates can find the document again
+            doc.add( *( _CLNEW Field( _T( "trackid" ), QString::number( id ).toStdWString().c_str(),
+                                      Field::STORE_YES | Field::INDEX_UNTOKENIZED ) ) );
+        }
+        else if ( values.contains( "album" ) )
+        {
+            doc.add( *( _CLNEW Field( _T( "album" ), DatabaseImpl::sortname( values.value( "album" ) ).toStdWString().c_str(),
+                                      Field::STORE_NO | Field::INDEX_UNTOKENIZED ) ) );
+
+            doc.add( *( _CLNEW Field( _T( "albumid" ), QString::number( id ).toStdWString().c_str(),
+                                      Field::STORE_YES | Field::INDEX_UNTOKENIZED ) ) );
+
+            // only stored, so suggestions don't have to look up the names in the database
+            doc.add( *( _CLNEW Field( _T( "name" ), values.value( "album" ).toStdWString().c_str(),
+                                      Field::STORE_YES | Field::INDEX_NO ) ) );
+
+            doc.add( *( _CLNEW Field( _T( "albumartistid" ), values.value( "artistid" ).toStdWString().c_str(),
+                                      Field::STORE_YES | Field::INDEX_NO ) ) );
+
+            doc.add( *( _CLNEW Field( _T( "albumartist" ), values.value( "artist" ).toStdWString().c_str(),
+                                      Field::STORE_YES | Field::INDEX_NO ) ) );
+        }
+        else if ( values.contains( "artist" ) )
+        {
+            doc.add( *( _CLNEW Field( _T( "artistname" ), DatabaseImpl::sortname( values.value( "artist" ) ).toStdWString().c_str(),
+                                      Field::STORE_NO | Field::INDEX_UNTOKENIZED ) ) );
+
+            doc.add( *( _CLNEW Field( _T( "artistid" ), QString::number( id ).toStdWString().c_str(),
+                                      Field::STORE_YES | Field::INDEX_UNTOKENIZED ) ) );
+
+            doc.add( *( _CLNEW Field( _T( "name" ), values.value( "artist" ).toStdWString().c_str(),
+                                      Field::STORE_YES | Field::INDEX_NO ) ) );
+        }
+        else
+            Q_ASSERT( false );
+
+        luceneWriter.addDocument( &doc );
+        doc.clear();
+    }
+}
+
+
+void
+FuzzyIndex::mergeIndex()
+{
+    QMutexLocker lock( &m_writeMutex );
+
+    if ( !m_pendingChanges )
+        return;
+
+    if ( m_trigramIndex )
+    {
+        m_trigramIndex->merge();
+        m_pendingChanges = 0;
+        return;
+    }
+
+    QTime t;
+    t.start();
+
+    try
+    {
+        IndexWriter luceneWriter( m_luceneDir, m_analyzer, false );
         luceneWriter.optimize();
         luceneWriter.close();
     }
@@ -161,36 +546,119 @@ FuzzyIndex::appendFields( const QMap< unsigned int, QMap< QString, QString > >&
         qDebug() << "Caught CLucene error:" << error.what();
         Q_ASSERT( false );
     }
+
+    refreshSearcher();
+    tDebug() << "Merged" << m_pendingChanges << "index changes in" << t.elapsed() << "ms";
+    m_pendingChanges = 0;
+}
+
+
+void
+FuzzyIndex::scheduleMerge()
+{
+    // don't postpone a scheduled merge, changes might keep coming in
+    if ( !m_mergeTimer.isActive() )
+        m_mergeTimer.start();
+}
+
+
+void
+FuzzyIndex::onMergeTimeout()
+{
+    DatabaseCommand* cmd = new DatabaseCommand_MergeSearchIndex();
+    Database::instance()->enqueue( QSharedPointer<DatabaseCommand>( cmd ) );
 }
 
 
 void
 FuzzyIndex::loadLuceneIndex()
 {
+    // if the index is being written to right now, the writer takes the snapshot when it's done.
+    // The trigram index got loaded already
+    if ( !m_trigramIndex && m_writeMutex.tryLock() )
+    {
+        refreshSearcher();
+        m_writeMutex.unlock();
+    }
+
     emit indexReady();
 }
 
 
-QMap< int, float >
-FuzzyIndex::search( const Tomahawk::query_ptr& query )
+QSharedPointer< IndexSearcher >
+FuzzyIndex::searcher()
 {
-    QMutexLocker lock( &m_mutex );
+    QMutexLocker lock( &m_searcherMutex );
+    return m_searcher;
+}
 
-    QMap< int, float > resultsmap;
+
+void
+FuzzyIndex::refreshSearcher()
+{
+    QSharedPointer< IndexSearcher > searcher;
     try
     {
-        if ( !m_luceneReader )
-        {
-            if ( !IndexReader::indexExists( TomahawkUtils::appDataDir().absoluteFilePath( "tomahawk.lucene" ).toStdString().c_str() ) )
-            {
-                qDebug() << Q_FUNC_INFO << "index didn't exist.";
-                return resultsmap;
-            }
+        if ( IndexReader::indexExists( m_lucenePath.toStdString().c_str() ) )
+            searcher = QSharedPointer< IndexSearcher >( _CLNEW IndexSearcher( IndexReader::open( m_luceneDir ) ), closeSnapshot );
+        else
+            qDebug() << Q_FUNC_INFO << "index didn't exist.";
+    }
+    catch( CLuceneError& error )
+    {
+        tDebug() << "Caught CLucene error:" << error.what();
+        Q_ASSERT( false );
+    }
 
-            m_luceneReader = IndexReader::open( m_luceneDir );
-            m_luceneSearcher = _CLNEW IndexSearcher( m_luceneReader );
-        }
+    // searches still running on the old snapshot keep it alive until they're done
+    QMutexLocker lock( &m_searcherMutex );
+    m_searcher = searcher;
+}
+
+
+QList< QPair< int, float > >
+FuzzyIndex::search( const Tomahawk::query_ptr& query, uint limit )
+{
+    if ( m_trigramIndex )
+        return doSearch( *m_trigramIndex->snapshot(), query, limit );
+
+    const QSharedPointer< IndexSearcher > snapshot = searcher();
+    if ( snapshot.isNull() )
+        return QList< QPair< int, float > >();
 
+    return doSearch( snapshot.data(), query, limit );
+}
+
+
+QList< QList< QPair< int, float > > >
+FuzzyIndex::search( const QList< Tomahawk::query_ptr >& queries, uint limit )
+{
+    QList< QList< QPair< int, float > > > results;
+
+    // all queries of the batch share the same snapshot
+    if ( m_trigramIndex )
+    {
+        const QSharedPointer< TrigramIndex::Snapshot > snapshot = m_trigramIndex->snapshot();
+        foreach ( const Tomahawk::query_ptr& query, queries )
+            results << doSearch( *snapshot, query, limit );
+
+        return results;
+    }
+
+    const QSharedPointer< IndexSearcher > snapshot = searcher();
+    foreach ( const Tomahawk::query_ptr& query, queries )
+        results << ( snapshot.isNull() ? QList< QPair< int, float > >() : doSearch( snapshot.data(), query, limit ) );
+
+    return results;
+}
+
+
+QList< QPair< int, float > >
+FuzzyIndex::doSearch( IndexSearcher* searcher, const Tomahawk::query_ptr& query, uint limit )
+{
+    TopScores top( limit );
+    try
+    {
         float minScore;
         const TCHAR** fields = 0;
         MultiFieldQueryParser parser( fields, m_analyzer );
@@ -216,7 +684,7 @@ FuzzyIndex::search( const Tomahawk::query_ptr& query )
         }
         else
         {
-            QString track = QString::fromWCharArray( parser.escape( DatabaseImpl::sortname( query->track() ).toStdWString().c_str() ) );
+            QString track = QString::fromWCharArray( parser.escape( query->trackSortname().toStdWString().c_str() ) );
             QString artist = QString::fromWCharArray( parser.escape( DatabaseImpl::sortname( query->artist() ).toStdWString().c_str() ) );
 //            QString album = QString::fromWCharArray( parser.escape( query->album().toStdWString().c_str() ) );
 
@@ -231,19 +699,17 @@ FuzzyIndex::search( const Tomahawk::query_ptr& query )
             minScore = 0.00;
         }
 
-        Hits* hits = m_luceneSearcher->search( qry );
+        // hits come best first, so there's no need to load the documents past the limit
+        Hits* hits = searcher->search( qry );
         for ( uint i = 0; i < hits->length(); i++ )
         {
-            Document* d = &hits->doc( i );
-
             float score = hits->score( i );
-            int id = QString::fromWCharArray( d->get( _T( "trackid" ) ) ).toInt();
+            if ( score <= minScore || !top.accepts( score ) )
+                break;
 
-            if ( score > minScore )
-            {
-                resultsmap.insert( id, score );
-//                tDebug() << "Index hit:" << id << score << QString::fromWCharArray( ((Query*)qry)->toString() );
-            }
+            Document* d = &hits->doc( i );
+            top.insert( documentId( d->get( _T( "trackid" ) ) ), score );
+//            tDebug() << "Index hit:" << d->get( _T( "trackid" ) ) << score << QString::fromWCharArray( ((Query*)qry)->toString() );
         }
 
         delete hits;
@@ -255,53 +721,166 @@ FuzzyIndex::search( const Tomahawk::query_ptr& query )
         Q_ASSERT( false );
     }
 
-    return resultsmap;
+    return top.sorted();
 }
 
 
-QMap< int, float >
-FuzzyIndex::searchAlbum( const Tomahawk::query_ptr& query )
+QList< QPair< int, float > >
+FuzzyIndex::doSearch( const TrigramIndex::Snapshot& snapshot, const Tomahawk::query_ptr& query, uint limit )
 {
-    Q_ASSERT( query->isFullTextQuery() );
-
-    QMutexLocker lock( &m_mutex );
+    TopScores top( limit );
 
-    QMap< int, float > resultsmap;
-    try
+    if ( query->isFullTextQuery() )
     {
-        if ( !m_luceneReader )
+        // any of the fields may match, the best one counts
+        QHash< int, float > best;
+        const QString text = DatabaseImpl::sortname( query->fullTextQuery() );
+        const TrigramIndex::Field fields[] = { TrigramIndex::TrackField, TrigramIndex::ArtistField, TrigramIndex::FullTextField };
+        for ( int i = 0; i < 3; i++ )
         {
-            if ( !IndexReader::indexExists( TomahawkUtils::appDataDir().absoluteFilePath( "tomahawk.lucene" ).toStdString().c_str() ) )
+            const QHash< int, float > hits = snapshot.search( fields[i], text );
+            for ( QHash< int, float >::const_iterator it = hits.constBegin(); it != hits.constEnd(); ++it )
             {
-                qDebug() << Q_FUNC_INFO << "index didn't exist.";
-                return resultsmap;
+                if ( it.value() > best.value( it.key(), 0.0 ) )
+                    best.insert( it.key(), it.value() );
             }
+        }
+
+        for ( QHash< int, float >::const_iterator it = best.constBegin(); it != best.constEnd(); ++it )
+            top.insert( it.key(), it.value() );
+    }
+    else
+    {
+        // both track and artist have to match
+        const QHash< int, float > tracks = snapshot.search( TrigramIndex::TrackField, query->trackSortname() );
+        if ( tracks.isEmpty() )
+            return top.sorted();
 
-            m_luceneReader = IndexReader::open( m_luceneDir );
-            m_luceneSearcher = _CLNEW IndexSearcher( m_luceneReader );
+        const QHash< int, float > artists = snapshot.search( TrigramIndex::ArtistField, DatabaseImpl::sortname( query->artist() ) );
+        for ( QHash< int, float >::const_iterator it = tracks.constBegin(); it != tracks.constEnd(); ++it )
+        {
+            if ( artists.contains( it.key() ) )
+                top.insert( it.key(), ( it.value() + artists.value( it.key() ) ) / 2 );
         }
+    }
 
-        QueryParser parser( _T( "album" ), m_analyzer );
-        QString escapedName = QString::fromWCharArray( parser.escape( DatabaseImpl::sortname( query->fullTextQuery() ).toStdWString().c_str() ) );
+    return top.sorted();
+}
 
-        Query* qry = _CLNEW FuzzyQuery( _CLNEW Term( _T( "album" ), escapedName.toStdWString().c_str() ) );
-        Hits* hits = m_luceneSearcher->search( qry );
-        for ( uint i = 0; i < hits->length(); i++ )
+
+QList< FuzzyIndex::NameMatch >
+FuzzyIndex::searchArtists( const QString& text, uint limit )
+{
+    if ( m_trigramIndex )
+        return searchNames( *m_trigramIndex->snapshot(), TrigramIndex::ArtistNameField, text, limit );
+
+    return searchNames( _T( "artistname" ), _T( "artistid" ), text, limit );
+}
+
+
+QList< FuzzyIndex::NameMatch >
+FuzzyIndex::searchAlbums( const QString& text, uint limit )
+{
+    if ( m_trigramIndex )
+        return searchNames( *m_trigramIndex->snapshot(), TrigramIndex::AlbumField, text, limit );
+
+    return searchNames( _T( "album" ), _T( "albumid" ), text, limit );
+}
+
+
+QList< FuzzyIndex::NameMatch >
+FuzzyIndex::searchNames( const wchar_t* field, const wchar_t* idField, const QString& text, uint limit )
+{
+    QList< NameMatch > matches;
+
+    const QString name = DatabaseImpl::sortname( text );
+    const QSharedPointer< IndexSearcher > snapshot = searcher();
+    if ( name.isEmpty() || snapshot.isNull() )
+        return matches;
+
+    try
+    {
+        IndexReader* reader = snapshot->getReader();
+        QHash< int, float > scores; // by document number
+
+        // similar names. Hits come best first, so only the first limit of them can make it
+        QueryParser parser( field, m_analyzer );
+        QString escapedName = QString::fromWCharArray( parser.escape( name.toStdWString().c_str() ) );
+
+        Query* qry = _CLNEW FuzzyQuery( _CLNEW Term( field, escapedName.toStdWString().c_str() ) );
+        Hits* hits = snapshot->search( qry );
+        for ( uint i = 0; i < hits->length() && ( !limit || i < limit ); i++ )
         {
-            Document* d = &hits->doc( i );
+            const float score = hits->score( i );
+            if ( score <= 0.30 )
+                break;
 
-            float score = hits->score( i );
-            int id = QString::fromWCharArray( d->get( _T( "albumid" ) ) ).toInt();
+            scores.insert( hits->id( i ), score );
+        }
+
+        delete hits;
+        delete qry;
+
+        // names starting with it, scored by how much of the name is given. The terms are
+        // sorted, so these follow right after the first one not less than the prefix
+        const uint maxCandidates = prefixCandidates( name, limit );
+        uint candidates = 0;
+        const std::wstring prefix = name.toStdWString();
+        Term* prefixTerm = _CLNEW Term( field, prefix.c_str() );
+        TermEnum* terms = reader->terms( prefixTerm );
+        do
+        {
+            if ( candidates >= maxCandidates )
+                break;
+
+            Term* term = terms->term( false );
+            if ( !term || _tcscmp( term->field(), field ) != 0 )
+                break;
 
-            if ( score > 0.30 )
+            const TCHAR* value = term->text();
+            const size_t length = _tcslen( value );
+            if ( length < prefix.length() || _tcsncmp( value, prefix.c_str(), prefix.length() ) != 0 )
+                break;
+
+            const float coverage = (float)prefix.length() / length;
+            TermDocs* docs = reader->termDocs( term );
+            while ( docs->next() )
             {
-                resultsmap.insert( id, score );
-//                tDebug() << "Index hit:" << id << score;
+                candidates++;
+                if ( coverage > scores.value( docs->doc(), 0.0 ) )
+                    scores.insert( docs->doc(), coverage );
             }
+
+            docs->close();
+            _CLDELETE( docs );
         }
+        while ( terms->next() );
 
-        delete hits;
-        delete qry;
+        terms->close();
+        _CLDELETE( terms );
+        _CLDECDELETE( prefixTerm );
+
+        // only the documents of the best ones get loaded
+        TopScores top( limit );
+        for ( QHash< int, float >::const_iterator it = scores.constBegin(); it != scores.constEnd(); ++it )
+            top.insert( it.key(), it.value() );
+
+        typedef QPair< int, float > ScorePair;
+        foreach ( const ScorePair& pair, top.sorted() )
+        {
+            Document doc;
+            if ( !reader->document( pair.first, &doc ) )
+                continue;
+
+            NameMatch match;
+            match.id = documentId( doc.get( idField ) );
+            match.score = pair.second;
+            match.name = storedString( doc, _T( "name" ) );
+            match.artistId = documentId( doc.get( _T( "albumartistid" ) ) );
+            match.artistName = storedString( doc, _T( "albumartist" ) );
+
+            matches << match;
+        }
     }
     catch( CLuceneError& error )
     {
@@ -309,5 +888,36 @@ FuzzyIndex::searchAlbum( const Tomahawk::query_ptr& query )
         Q_ASSERT( false );
     }
 
-    return resultsmap;
+    return matches;
+}
+
+
+QList< FuzzyIndex::NameMatch >
+FuzzyIndex::searchNames( const TrigramIndex::Snapshot& snapshot, TrigramIndex::Field field, const QString& text, uint limit )
+{
+    const QString name = DatabaseImpl::sortname( text );
+    const QHash< int, TrigramIndex::Snapshot::Match > hits = snapshot.searchNames( field, name, prefixCandidates( name, limit ) );
+
+    TopScores top( limit );
+    for ( QHash< int, TrigramIndex::Snapshot::Match >::const_iterator it = hits.constBegin(); it != hits.constEnd(); ++it )
+        top.insert( it.key(), it.value().score );
+
+    QList< NameMatch > matches;
+    typedef QPair< int, float > ScorePair;
+    foreach ( const ScorePair& pair, top.sorted() )
+    {
+        NameMatch match;
+        match.id = pair.first;
+        match.score = pair.second;
+
+        // albums store their name, artist id and artist name, artists only their name
+        const QStringList stored = snapshot.stored( field, hits.value( pair.first ) ).split( STORED_SEPARATOR );
+        match.name = stored.value( 0 );
+        match.artistId = stored.value( 1 ).toInt();
+        match.artistName = stored.value( 2 );
+
+        matches << match;
+    }
+
+    return matches;
 }
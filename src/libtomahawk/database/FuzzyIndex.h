@@ -21,11 +21,15 @@
 
 #include <QObject>
 #include <QMap>
+#include <QPair>
 #include <QHash>
 #include <QString>
 #include <QMutex>
+#include <QSharedPointer>
+#include <QTimer>
 
 #include "Query.h"
+#include "TrigramIndex.h"
 
 namespace lucene
 {
@@ -50,36 +54,102 @@ namespace lucene
 
 class DatabaseImpl;
 
+/*
+    The search index of all tracks, albums and artists. It is backed by Lucene, or by a
+    TrigramIndex if asked to (Tomahawk's --trigramindex).
+*/
 class FuzzyIndex : public QObject
 {
 Q_OBJECT
 
 public:
-    explicit FuzzyIndex( DatabaseImpl& db, bool wipeIndex = false );
+    // an artist or album found by its name. artistId & artistName are only set for albums
+    struct NameMatch
+    {
+        NameMatch() : id( 0 ), score( 0.0 ), artistId( 0 ) {}
+
+        int id;
+        float score;
+        QString name;
+        int artistId;
+        QString artistName;
+    };
+
+    FuzzyIndex( DatabaseImpl& db, bool trigramIndex, bool wipeIndex = false );
     ~FuzzyIndex();
 
+    // false if there is nothing on disk yet, so the index has to be built
+    bool indexExists() const;
+
+    // a full rebuild: beginIndexing() wipes the index, endIndexing() merges it
     void beginIndexing();
     void endIndexing();
+    // documents keyed by track, album or artist id. Tracks have a "track" and "artist",
+    // albums an "album", "artist" and "artistid", artists only an "artist" value
     void appendFields( const QMap< unsigned int, QMap< QString, QString > >& trackData );
-    
+
+    // incremental changes, documents with the same trackid / albumid / artistid get replaced.
+    // Deleted documents only get purged by the next merge
+    void updateFields( const QMap< unsigned int, QMap< QString, QString > >& trackData );
+    void deleteFields( const QList< unsigned int >& trackIds, const QList< unsigned int >& albumIds, const QList< unsigned int >& artistIds );
+
+    // artists & albums whose names are similar to text, or start with it. The names are
+    // kept in the index, so suggestions can be shown without looking them up
+    QList< NameMatch > searchArtists( const QString& text, uint limit = 0 );
+    QList< NameMatch > searchAlbums( const QString& text, uint limit = 0 );
+
 signals:
     void indexReady();
 
 public slots:
     void loadLuceneIndex();
 
-    QMap< int, float > search( const Tomahawk::query_ptr& query );
-    QMap< int, float > searchAlbum( const Tomahawk::query_ptr& query );
+    // the best scoring ids, best first. A limit of 0 returns all hits
+    QList< QPair< int, float > > search( const Tomahawk::query_ptr& query, uint limit = 0 );
+    QList< QList< QPair< int, float > > > search( const QList< Tomahawk::query_ptr >& queries, uint limit = 0 );
+
+
+    // merges the segments written by incremental changes, does nothing if there weren't any
+    void mergeIndex();
+
+private slots:
+    void scheduleMerge();
+    void onMergeTimeout();
 
 private:
+    // the current snapshot of the index, null if there is no index yet
+    QSharedPointer< lucene::search::IndexSearcher > searcher();
+
+    // m_writeMutex must be locked when calling these
+    void refreshSearcher();
+    void addDocuments( lucene::index::IndexWriter& writer, const QMap< unsigned int, QMap< QString, QString > >& trackData );
+    void indexChanged( unsigned int changes );
+
+    QList< QPair< int, float > > doSearch( lucene::search::IndexSearcher* searcher, const Tomahawk::query_ptr& query, uint limit );
+    static QList< QPair< int, float > > doSearch( const TrigramIndex::Snapshot& snapshot, const Tomahawk::query_ptr& query, uint limit );
+    QList< NameMatch > searchNames( const wchar_t* field, const wchar_t* idField, const QString& text, uint limit );
+    static QList< NameMatch > searchNames( const TrigramIndex::Snapshot& snapshot, TrigramIndex::Field field, const QString& text, uint limit );
+
     DatabaseImpl& m_db;
-    QMutex m_mutex;
     QString m_lucenePath;
 
     lucene::analysis::SimpleAnalyzer* m_analyzer;
     lucene::store::Directory* m_luceneDir;
-    lucene::index::IndexReader* m_luceneReader;
-    lucene::search::IndexSearcher* m_luceneSearcher;
+
+    // serializes all writes to the index. Searches don't take it, they run on an
+    // immutable snapshot that gets replaced after every write. m_searcherMutex only
+    // guards swapping and copying the shared pointer
+    QMutex m_writeMutex;
+    QMutex m_searcherMutex;
+    QSharedPointer< lucene::search::IndexSearcher > m_searcher;
+
+    // replaces all of the above if set
+    TrigramIndex* m_trigramIndex;
+    QList< TrigramIndex::Entry > m_trigramEntries; // collected during a rebuild
+
+    // documents changed since the last merge
+    unsigned int m_pendingChanges;
+    QTimer m_mergeTimer;
 };
 
 #endif // FUZZYINDEX_H
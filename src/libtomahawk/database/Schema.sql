@@ -272,6 +272,21 @@ CREATE TABLE IF NOT EXISTS playback_log (
 
 CREATE INDEX playback_log_source ON playback_log(source);
 CREATE INDEX playback_log_track ON playback_log(track);
+CREATE INDEX playback_log_playtime ON playback_log(playtime);
+
+-- play counts per source and track, kept up to date by DatabaseCommand_LogPlayback
+-- so charts and stats don't have to scan the playback_log
+CREATE TABLE IF NOT EXISTS playback_stats (
+    source INTEGER REFERENCES source(id) ON DELETE CASCADE ON UPDATE CASCADE DEFERRABLE INITIALLY DEFERRED, -- null for local source
+    track INTEGER NOT NULL REFERENCES track(id) ON DELETE CASCADE ON UPDATE CASCADE DEFERRABLE INITIALLY DEFERRED,
+    plays INTEGER NOT NULL,
+    secs_played INTEGER NOT NULL,
+    first_played INTEGER NOT NULL,
+    last_played INTEGER NOT NULL
+);
+
+CREATE INDEX playback_stats_source_track ON playback_stats(source, track);
+CREATE INDEX playback_stats_track ON playback_stats(track);
 
 
 
@@ -295,4 +310,4 @@ CREATE TABLE IF NOT EXISTS settings (
     v TEXT NOT NULL DEFAULT ''
 );
 
-INSERT INTO settings(k,v) VALUES('schema_version', '28');
+INSERT INTO settings(k,v) VALUES('schema_version', '29');
@@ -1,5 +1,5 @@
 /*
-    This file was automatically generated from ./Schema.sql on Fri Nov 18 14:00:37 CET 2011.
+    This file was automatically generated from ./Schema.sql on Sat Oct 17 05:53:32 UTC 2026.
 */
 
 static const char * tomahawk_schema_sql = 
@@ -107,6 +107,7 @@ static const char * tomahawk_schema_sql =
 ");"
 "CREATE UNIQUE INDEX file_url_src_uniq ON file(source, url);"
 "CREATE INDEX file_source ON file(source);"
+"CREATE INDEX file_mtime ON file(mtime);"
 "CREATE TABLE IF NOT EXISTS dirs_scanned ("
 "    name TEXT PRIMARY KEY,"
 "    mtime INTEGER NOT NULL"
@@ -179,6 +180,17 @@ static const char * tomahawk_schema_sql =
 ");"
 "CREATE INDEX playback_log_source ON playback_log(source);"
 "CREATE INDEX playback_log_track ON playback_log(track);"
+"CREATE INDEX playback_log_playtime ON playback_log(playtime);"
+"CREATE TABLE IF NOT EXISTS playback_stats ("
+"    source INTEGER REFERENCES source(id) ON DELETE CASCADE ON UPDATE CASCADE DEFERRABLE INITIALLY DEFERRED, "
+"    track INTEGER NOT NULL REFERENCES track(id) ON DELETE CASCADE ON UPDATE CASCADE DEFERRABLE INITIALLY DEFERRED,"
+"    plays INTEGER NOT NULL,"
+"    secs_played INTEGER NOT NULL,"
+"    first_played INTEGER NOT NULL,"
+"    last_played INTEGER NOT NULL"
+");"
+"CREATE INDEX playback_stats_source_track ON playback_stats(source, track);"
+"CREATE INDEX playback_stats_track ON playback_stats(track);"
 "CREATE TABLE IF NOT EXISTS http_client_auth ("
 "    token TEXT NOT NULL PRIMARY KEY,"
 "    website TEXT NOT NULL,"
@@ -191,7 +203,7 @@ static const char * tomahawk_schema_sql =
 "    k TEXT NOT NULL PRIMARY KEY,"
 "    v TEXT NOT NULL DEFAULT ''"
 ");"
-"INSERT INTO settings(k,v) VALUES('schema_version', '28');"
+"INSERT INTO settings(k,v) VALUES('schema_version', '29');"
     ;
 
 const char * get_tomahawk_sql()
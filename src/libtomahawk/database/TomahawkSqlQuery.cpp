@@ -18,31 +18,139 @@
 
 #include "database/TomahawkSqlQuery.h"
 
+#include "database/DatabaseImpl.h"
 #include "utils/Logger.h"
 
 #include <QSqlError>
+#include <QMutex>
+#include <QSet>
 #include <QTime>
 #include <QVariant>
 
 #define QUERY_THRESHOLD 60
 
+static bool s_recording = false;
+static QStringList s_recordedStatements;
+static QSet< QString > s_recordedSet;
+static QMutex s_recordingMutex;
+
 
 TomahawkSqlQuery::TomahawkSqlQuery()
     : QSqlQuery()
+    , m_statementCache( 0 )
 {
 }
 
 
 TomahawkSqlQuery::TomahawkSqlQuery( const QSqlDatabase& db )
     : QSqlQuery( db )
+    , m_statementCache( 0 )
+{
+}
+
+
+TomahawkSqlQuery::TomahawkSqlQuery( const QSqlDatabase& db, DatabaseImpl* statementCache )
+    : QSqlQuery( db )
+    , m_statementCache( statementCache )
+{
+}
+
+
+TomahawkSqlQuery::TomahawkSqlQuery( const TomahawkSqlQuery& other )
+    : QSqlQuery( other )
+    , m_statementCache( other.m_statementCache )
+{
+}
+
+
+TomahawkSqlQuery::~TomahawkSqlQuery()
+{
+    releaseStatement();
+}
+
+
+TomahawkSqlQuery&
+TomahawkSqlQuery::operator=( const TomahawkSqlQuery& other )
+{
+    if ( this == &other )
+        return *this;
+
+    releaseStatement();
+    QSqlQuery::operator=( other );
+    m_statementCache = other.m_statementCache;
+
+    return *this;
+}
+
+
+// statements without placeholders are mostly one-offs with their values inlined,
+// caching them would only push out the ones that get reused
+static bool
+hasPlaceholders( const QString& query )
+{
+    for ( int i = 0; i < query.length(); i++ )
+    {
+        if ( query.at( i ) == '?' )
+            return true;
+
+        if ( query.at( i ) == ':' && i + 1 < query.length() &&
+             ( query.at( i + 1 ).isLetter() || query.at( i + 1 ) == '_' ) )
+            return true;
+    }
+
+    return false;
+}
+
+
+bool
+TomahawkSqlQuery::prepare( const QString& query )
 {
+    releaseStatement();
+    if ( !m_statementCache || !hasPlaceholders( query ) )
+        return QSqlQuery::prepare( query );
+
+    QSqlQuery* cached = m_statementCache->takeStatement( query );
+    if ( cached )
+    {
+        QSqlQuery::operator=( *cached );
+        delete cached;
+
+        // don't let values bound by the previous user stand in for ones that never get bound
+        const int bound = boundValues().count();
+        for ( int i = 0; i < bound; i++ )
+            bindValue( i, QVariant() );
+
+        m_statement = query;
+        return true;
+    }
+
+    const bool ret = QSqlQuery::prepare( query );
+    if ( ret )
+        m_statement = query;
+
+    return ret;
+}
+
+
+void
+TomahawkSqlQuery::releaseStatement()
+{
+    if ( m_statement.isEmpty() )
+        return;
+
+    // reset the statement, so it doesn't keep a read transaction open while cached
+    finish();
+    m_statementCache->returnStatement( m_statement, *this );
+    m_statement.clear();
 }
 
 
 bool
 TomahawkSqlQuery::exec( const QString& query )
 {
-    prepare( query );
+    // nothing can get bound to it, so it doesn't go through the statement cache
+    releaseStatement();
+    QSqlQuery::prepare( query );
     return exec();
 }
 
@@ -57,6 +165,16 @@ TomahawkSqlQuery::exec()
     if ( !ret )
         showError();
 
+    if ( s_recording )
+    {
+        QMutexLocker lock( &s_recordingMutex );
+        if ( !s_recordedSet.contains( lastQuery() ) )
+        {
+            s_recordedSet.insert( lastQuery() );
+            s_recordedStatements << lastQuery();
+        }
+    }
+
     int e = t.elapsed();
     bool log = ( e >= QUERY_THRESHOLD );
 #ifdef TOMAHAWK_QUERY_ANALYZE
@@ -70,6 +188,26 @@ TomahawkSqlQuery::exec()
 }
 
 
+void
+TomahawkSqlQuery::setRecording( bool enabled )
+{
+    QMutexLocker lock( &s_recordingMutex );
+    s_recording = enabled;
+}
+
+
+QStringList
+TomahawkSqlQuery::takeRecordedStatements()
+{
+    QMutexLocker lock( &s_recordingMutex );
+    const QStringList statements = s_recordedStatements;
+    s_recordedStatements.clear();
+    s_recordedSet.clear();
+
+    return statements;
+}
+
+
 void
 TomahawkSqlQuery::showError()
 {
@@ -19,24 +19,48 @@
 #ifndef TOMAHAWKSQLQUERY_H
 #define TOMAHAWKSQLQUERY_H
 
-// subclass QSqlQuery so that it prints the error msg if a query fails
+// subclass QSqlQuery so that it prints the error msg if a query fails,
+// and re-uses prepared statements of the DatabaseImpl it was created by.
+// Only statements with placeholders that got prepare()d are cached
 
 #include <QSqlQuery>
+#include <QString>
+#include <QStringList>
+
+#include "DllMacro.h"
 
 #define TOMAHAWK_QUERY_ANALYZE 1
 
-class TomahawkSqlQuery : public QSqlQuery
+class DatabaseImpl;
+
+class DLLEXPORT TomahawkSqlQuery : public QSqlQuery
 {
 
 public:
     TomahawkSqlQuery();
     TomahawkSqlQuery( const QSqlDatabase& db );
+    TomahawkSqlQuery( const QSqlDatabase& db, DatabaseImpl* statementCache );
+    // copies share the statement, but only the original hands it back to the cache
+    TomahawkSqlQuery( const TomahawkSqlQuery& other );
+    ~TomahawkSqlQuery();
+
+    TomahawkSqlQuery& operator=( const TomahawkSqlQuery& other );
 
+    bool prepare( const QString& query );
     bool exec( const QString& query );
     bool exec();
 
+    // while recording, the SQL of all executed statements is remembered, once each.
+    // Used to look at their query plans
+    static void setRecording( bool enabled );
+    static QStringList takeRecordedStatements();
+
 private:
+    void releaseStatement();
     void showError();
+
+    DatabaseImpl* m_statementCache;
+    QString m_statement;
 };
 
 #endif // TOMAHAWKSQLQUERY_H
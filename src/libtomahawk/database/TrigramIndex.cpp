@@ -0,0 +1,691 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2026, agent <agent@local>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TrigramIndex.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QMap>
+#include <QTime>
+#include <QVector>
+#include <QtAlgorithms>
+
+#include <algorithm>
+
+#include "utils/EditDistance.h"
+#include "utils/Logger.h"
+
+#define MANIFEST_NAME "manifest"
+#define MANIFEST_VERSION 2
+#define SEGMENT_MAGIC 0x54524947 // "TRIG"
+#define SEGMENT_VERSION 2
+// same as the default of Lucene's FuzzyQuery
+#define MIN_SIMILARITY 0.5
+// searches get slower with every segment, merge early once there are this many
+#define MAX_SEGMENTS 16
+
+
+static int
+maxDistance( int length )
+{
+    return (int)( length * ( 1.0 - MIN_SIMILARITY ) );
+}
+
+
+static inline ushort
+paddedChar( const ushort* str, int length, int i )
+{
+    // two padding characters on either side, so the start & end of a value weigh in
+    return ( i < 2 || i >= length + 2 ) ? 0 : str[ i - 2 ];
+}
+
+
+// the sorted, distinct trigrams of str, packed into one number each
+static QVector< quint64 >
+trigrams( const ushort* str, int length )
+{
+    QVector< quint64 > grams;
+    grams.reserve( length + 2 );
+    for ( int i = 0; i < length + 2; i++ )
+    {
+        grams << ( (quint64)paddedChar( str, length, i ) << 32 |
+                   (quint64)paddedChar( str, length, i + 1 ) << 16 |
+                   (quint64)paddedChar( str, length, i + 2 ) );
+    }
+
+    qSort( grams );
+    grams.erase( std::unique( grams.begin(), grams.end() ), grams.end() );
+    return grams;
+}
+
+
+static inline bool
+startsWith( const ushort* value, int valueLength, const ushort* prefix, int prefixLength )
+{
+    return valueLength >= prefixLength && std::equal( prefix, prefix + prefixLength, value );
+}
+
+
+template< typename T >
+static void
+appendArray( QByteArray& buffer, const QVector< T >& array )
+{
+    buffer.append( reinterpret_cast< const char* >( array.constData() ), array.count() * sizeof( T ) );
+    while ( buffer.size() % 8 )
+        buffer.append( '\0' );
+}
+
+
+// returns 0 if the array doesn't fit into size
+template< typename T >
+static const T*
+takeArray( const uchar* data, qint64 size, qint64& offset, quint32 count )
+{
+    const T* array = reinterpret_cast< const T* >( data + offset );
+
+    offset += (qint64)count * sizeof( T );
+    offset = ( offset + 7 ) & ~7;
+
+    return offset <= size ? array : 0;
+}
+
+
+QSharedPointer< TrigramIndex::Segment >
+TrigramIndex::Segment::build( const QList< Entry >& entries )
+{
+    QMap< QString, QMap< qint32, QString > > terms[ FieldCount ];
+    foreach ( const Entry& entry, entries )
+    {
+        if ( !entry.term.isEmpty() )
+            terms[ entry.field ][ entry.term ].insert( entry.id, entry.stored );
+    }
+
+    QVector< quint32 > header;
+    header << SEGMENT_MAGIC << SEGMENT_VERSION;
+
+    QByteArray body;
+    for ( int f = 0; f < FieldCount; f++ )
+    {
+        QVector< quint32 > termOffsets, docOffsets, storedOffsets;
+        QVector< ushort > chars, storedChars;
+        QVector< qint32 > docs;
+        QMap< quint64, QVector< quint32 > > grams;
+
+        termOffsets << 0;
+        docOffsets << 0;
+        storedOffsets << 0;
+
+        quint32 termNumber = 0;
+        QMapIterator< QString, QMap< qint32, QString > > it( terms[ f ] );
+        while ( it.hasNext() )
+        {
+            it.next();
+            const QString& term = it.key();
+
+            for ( int i = 0; i < term.length(); i++ )
+                chars << term.at( i ).unicode();
+            termOffsets << chars.count();
+
+            // sorted by id, and each document only once
+            QMapIterator< qint32, QString > dit( it.value() );
+            while ( dit.hasNext() )
+            {
+                dit.next();
+                docs << dit.key();
+
+                const QString& stored = dit.value();
+                for ( int i = 0; i < stored.length(); i++ )
+                    storedChars << stored.at( i ).unicode();
+                storedOffsets << storedChars.count();
+            }
+            docOffsets << docs.count();
+
+            foreach ( quint64 gram, trigrams( term.utf16(), term.length() ) )
+                grams[ gram ] << termNumber;
+
+            termNumber++;
+        }
+
+        QVector< quint64 > keys;
+        QVector< quint32 > postingOffsets, postings;
+        postingOffsets << 0;
+
+        QMapIterator< quint64, QVector< quint32 > > git( grams );
+        while ( git.hasNext() )
+        {
+            git.next();
+            keys << git.key();
+            postings << git.value();
+            postingOffsets << postings.count();
+        }
+
+        header << termNumber << chars.count() << keys.count() << postings.count() << docs.count() << storedChars.count();
+
+        appendArray( body, termOffsets );
+        appendArray( body, chars );
+        appendArray( body, keys );
+        appendArray( body, postingOffsets );
+        appendArray( body, postings );
+        appendArray( body, docOffsets );
+        appendArray( body, docs );
+        appendArray( body, storedOffsets );
+        appendArray( body, storedChars );
+    }
+
+    QByteArray data;
+    appendArray( data, header );
+    data.append( body );
+
+    // a QVector< quint64 > keeps the arrays aligned in memory
+    QSharedPointer< Segment > segment( new Segment() );
+    segment->m_buffer.resize( data.size() / sizeof( quint64 ) );
+    memcpy( segment->m_buffer.data(), data.constData(), data.size() );
+
+    const bool valid = segment->parse( reinterpret_cast< const uchar* >( segment->m_buffer.constData() ), data.size() );
+    Q_ASSERT( valid );
+    Q_UNUSED( valid );
+
+    return segment;
+}
+
+
+QSharedPointer< TrigramIndex::Segment >
+TrigramIndex::Segment::map( const QString& fileName )
+{
+    QSharedPointer< Segment > segment( new Segment() );
+    segment->m_file = new QFile( fileName );
+    if ( !segment->m_file->open( QIODevice::ReadOnly ) )
+        return QSharedPointer< Segment >();
+
+    const qint64 size = segment->m_file->size();
+    const uchar* data = segment->m_file->map( 0, size );
+    if ( !data || !segment->parse( data, size ) )
+    {
+        tLog() << "Invalid trigram index segment:" << fileName;
+        return QSharedPointer< Segment >();
+    }
+
+    return segment;
+}
+
+
+TrigramIndex::Segment::~Segment()
+{
+    // unmaps the file
+    delete m_file;
+}
+
+
+bool
+TrigramIndex::Segment::parse( const uchar* data, qint64 size )
+{
+    const qint64 headerSize = ( 2 + 6 * FieldCount ) * sizeof( quint32 );
+    if ( size < headerSize )
+        return false;
+
+    const quint32* header = reinterpret_cast< const quint32* >( data );
+    if ( header[0] != SEGMENT_MAGIC || header[1] != SEGMENT_VERSION )
+        return false;
+
+    qint64 offset = ( headerSize + 7 ) & ~7;
+    for ( int f = 0; f < FieldCount; f++ )
+    {
+        const quint32* counts = header + 2 + 6 * f;
+        FieldData& field = m_fields[ f ];
+
+        field.termCount = counts[0];
+        field.trigramCount = counts[2];
+        field.termOffsets = takeArray< quint32 >( data, size, offset, counts[0] + 1 );
+        field.chars = takeArray< ushort >( data, size, offset, counts[1] );
+        field.trigrams = takeArray< quint64 >( data, size, offset, counts[2] );
+        field.postingOffsets = takeArray< quint32 >( data, size, offset, counts[2] + 1 );
+        field.postings = takeArray< quint32 >( data, size, offset, counts[3] );
+        field.docOffsets = takeArray< quint32 >( data, size, offset, counts[0] + 1 );
+        field.docs = takeArray< qint32 >( data, size, offset, counts[4] );
+        field.storedOffsets = takeArray< quint32 >( data, size, offset, counts[4] + 1 );
+        field.storedChars = takeArray< ushort >( data, size, offset, counts[5] );
+
+        if ( !field.termOffsets || !field.chars || !field.trigrams || !field.postingOffsets ||
+             !field.postings || !field.docOffsets || !field.docs || !field.storedOffsets || !field.storedChars )
+            return false;
+
+        if ( field.termOffsets[ field.termCount ] != counts[1] ||
+             field.postingOffsets[ field.trigramCount ] != counts[3] ||
+             field.docOffsets[ field.termCount ] != counts[4] ||
+             field.storedOffsets[ counts[4] ] != counts[5] )
+            return false;
+    }
+
+    m_data = data;
+    m_size = size;
+    return offset == size;
+}
+
+
+bool
+TrigramIndex::Segment::save( const QString& fileName ) const
+{
+    QFile file( fileName );
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+        return false;
+
+    return file.write( reinterpret_cast< const char* >( m_data ), m_size ) == m_size;
+}
+
+
+QList< TrigramIndex::Entry >
+TrigramIndex::Segment::entries() const
+{
+    QList< Entry > result;
+    for ( int f = 0; f < FieldCount; f++ )
+    {
+        const FieldData& data = m_fields[ f ];
+        for ( quint32 t = 0; t < data.termCount; t++ )
+        {
+            const QString term = QString::fromUtf16( data.chars + data.termOffsets[t], data.termOffsets[t + 1] - data.termOffsets[t] );
+            for ( quint32 d = data.docOffsets[t]; d < data.docOffsets[t + 1]; d++ )
+            {
+                const QString stored = QString::fromUtf16( data.storedChars + data.storedOffsets[d], data.storedOffsets[d + 1] - data.storedOffsets[d] );
+                result << Entry( (Field)f, term, data.docs[d], stored );
+            }
+        }
+    }
+
+    return result;
+}
+
+
+// keeps the best match per document
+static inline void
+addMatch( QHash< int, TrigramIndex::Snapshot::Match >& matches, int id, float score, int segment, quint32 doc )
+{
+    TrigramIndex::Snapshot::Match& match = matches[ id ];
+    if ( score > match.score )
+    {
+        match.score = score;
+        match.segment = segment;
+        match.doc = doc;
+    }
+}
+
+
+QHash< int, float >
+TrigramIndex::Snapshot::search( Field field, const QString& term ) const
+{
+    QHash< int, Match > matches;
+    fuzzyMatches( field, term, matches );
+
+    QHash< int, float > results;
+    for ( QHash< int, Match >::const_iterator it = matches.constBegin(); it != matches.constEnd(); ++it )
+        results.insert( it.key(), it.value().score );
+
+    return results;
+}
+
+
+QHash< int, TrigramIndex::Snapshot::Match >
+TrigramIndex::Snapshot::searchNames( Field field, const QString& term, uint maxPrefixMatches ) const
+{
+    QHash< int, Match > matches;
+    fuzzyMatches( field, term, matches );
+    prefixMatches( field, term, maxPrefixMatches, matches );
+
+    return matches;
+}
+
+
+QString
+TrigramIndex::Snapshot::stored( Field field, const Match& match ) const
+{
+    const Segment::FieldData& data = m_segments.at( match.segment )->field( field );
+    return QString::fromUtf16( data.storedChars + data.storedOffsets[ match.doc ], data.storedOffsets[ match.doc + 1 ] - data.storedOffsets[ match.doc ] );
+}
+
+
+void
+TrigramIndex::Snapshot::fuzzyMatches( Field field, const QString& term, QHash< int, Match >& matches ) const
+{
+    const int length = term.length();
+    if ( !length )
+        return;
+
+    const ushort* query = term.utf16();
+    const QVector< quint64 > grams = trigrams( query, length );
+
+    // every edit changes at most four trigrams, three for the others and four for a transposition.
+    // Short queries allow so many edits that a match wouldn't need to share any, we want at least one
+    const int minShared = qMax( 1, grams.count() - 4 * maxDistance( length ) );
+
+    for ( int s = 0; s < m_segments.count(); s++ )
+    {
+        const Segment::FieldData& data = m_segments.at( s )->field( field );
+        const quint64* end = data.trigrams + data.trigramCount;
+
+        QHash< quint32, int > shared;
+        foreach ( quint64 gram, grams )
+        {
+            const quint64* it = qBinaryFind( data.trigrams, end, gram );
+            if ( it == end )
+                continue;
+
+            const int i = it - data.trigrams;
+            for ( quint32 p = data.postingOffsets[i]; p < data.postingOffsets[i + 1]; p++ )
+                shared[ data.postings[p] ]++;
+        }
+
+        QHashIterator< quint32, int > it( shared );
+        while ( it.hasNext() )
+        {
+            it.next();
+            if ( it.value() < minShared )
+                continue;
+
+            const quint32 t = it.key();
+            const ushort* value = data.chars + data.termOffsets[t];
+            const int valueLength = data.termOffsets[t + 1] - data.termOffsets[t];
+
+            // like Lucene, relative to the shorter one of both
+            const int shorter = qMin( length, valueLength );
+            const int allowed = maxDistance( shorter );
+            const int distance = TomahawkUtils::editDistance( query, length, value, valueLength, allowed );
+            if ( distance > allowed )
+                continue;
+
+            const float similarity = 1.0 - (float)distance / shorter;
+            for ( quint32 d = data.docOffsets[t]; d < data.docOffsets[t + 1]; d++ )
+            {
+                if ( !isDeleted( field, data.docs[d], s ) )
+                    addMatch( matches, data.docs[d], similarity, s, d );
+            }
+        }
+    }
+}
+
+
+void
+TrigramIndex::Snapshot::prefixMatches( Field field, const QString& prefix, uint maxMatches, QHash< int, Match >& matches ) const
+{
+    const int length = prefix.length();
+    if ( !length )
+        return;
+
+    const ushort* query = prefix.utf16();
+    uint visited = 0;
+    for ( int s = 0; s < m_segments.count() && visited < maxMatches; s++ )
+    {
+        const Segment::FieldData& data = m_segments.at( s )->field( field );
+
+        // the terms are sorted, the ones starting with prefix follow the first one not less than it
+        quint32 first = 0;
+        quint32 last = data.termCount;
+        while ( first < last )
+        {
+            const quint32 t = first + ( last - first ) / 2;
+            const ushort* value = data.chars + data.termOffsets[t];
+            if ( std::lexicographical_compare( value, data.chars + data.termOffsets[t + 1], query, query + length ) )
+                first = t + 1;
+            else
+                last = t;
+        }
+
+        for ( quint32 t = first; t < data.termCount && visited < maxMatches; t++ )
+        {
+            const ushort* value = data.chars + data.termOffsets[t];
+            const int valueLength = data.termOffsets[t + 1] - data.termOffsets[t];
+            if ( !startsWith( value, valueLength, query, length ) )
+                break;
+
+            const float coverage = (float)length / valueLength;
+            visited += data.docOffsets[t + 1] - data.docOffsets[t];
+            for ( quint32 d = data.docOffsets[t]; d < data.docOffsets[t + 1]; d++ )
+            {
+                if ( !isDeleted( field, data.docs[d], s ) )
+                    addMatch( matches, data.docs[d], coverage, s, d );
+            }
+        }
+    }
+}
+
+
+bool
+TrigramIndex::Snapshot::isDeleted( Field field, int id, int segment ) const
+{
+    const QHash< int, int >& deleted = ( field == AlbumField ) ? m_deletedAlbums :
+                                       ( field == ArtistNameField ) ? m_deletedArtists : m_deletedTracks;
+    return deleted.value( id, 0 ) > segment;
+}
+
+
+QHash< int, int >&
+TrigramIndex::Snapshot::deletedIds( Field field )
+{
+    if ( field == AlbumField )
+        return m_deletedAlbums;
+    if ( field == ArtistNameField )
+        return m_deletedArtists;
+
+    return m_deletedTracks;
+}
+
+
+TrigramIndex::TrigramIndex( const QString& path )
+    : m_path( path )
+    , m_exists( false )
+    , m_nextSegment( 0 )
+    , m_snapshot( new Snapshot() )
+{
+    QDir().mkpath( m_path );
+    load();
+}
+
+
+QSharedPointer< TrigramIndex::Snapshot >
+TrigramIndex::snapshot() const
+{
+    QMutexLocker lock( &m_snapshotMutex );
+    return m_snapshot;
+}
+
+
+void
+TrigramIndex::load()
+{
+    QTime t;
+    t.start();
+
+    QFile file( QDir( m_path ).filePath( MANIFEST_NAME ) );
+    if ( !file.open( QIODevice::ReadOnly ) )
+        return;
+
+    quint32 version;
+    qint32 nextSegment;
+    QSharedPointer< Snapshot > snapshot( new Snapshot() );
+
+    QDataStream stream( &file );
+    stream >> version;
+    if ( version != MANIFEST_VERSION )
+        return;
+
+    stream >> nextSegment >> snapshot->m_segmentFiles
+           >> snapshot->m_deletedTracks >> snapshot->m_deletedAlbums >> snapshot->m_deletedArtists;
+    if ( stream.status() != QDataStream::Ok )
+        return;
+
+    foreach ( const QString& name, snapshot->m_segmentFiles )
+    {
+        const QSharedPointer< Segment > segment = Segment::map( QDir( m_path ).filePath( name ) );
+        if ( segment.isNull() )
+            return;
+
+        snapshot->m_segments << segment;
+    }
+
+    m_nextSegment = nextSegment;
+    m_exists = true;
+    publish( snapshot );
+    removeUnusedFiles( *snapshot );
+
+    tLog( LOGVERBOSE ) << "Loaded trigram index with" << snapshot->m_segments.count() << "segments in" << t.elapsed() << "ms";
+}
+
+
+void
+TrigramIndex::reset( const QList< Entry >& entries )
+{
+    QSharedPointer< Snapshot > snapshot( new Snapshot() );
+
+    const QSharedPointer< Segment > segment = Segment::build( entries );
+    snapshot->m_segmentFiles << addSegment( segment );
+    snapshot->m_segments << segment;
+
+    writeManifest( *snapshot );
+    publish( snapshot );
+    removeUnusedFiles( *snapshot );
+    m_exists = true;
+}
+
+
+void
+TrigramIndex::update( const QList< Entry >& entries )
+{
+    if ( entries.isEmpty() )
+        return;
+
+    const QSharedPointer< Snapshot > current = snapshot();
+    QSharedPointer< Snapshot > next( new Snapshot( *current ) );
+
+    // the new segment has to be the only one with these ids
+    const int segments = current->m_segments.count();
+    foreach ( const Entry& entry, entries )
+        next->deletedIds( entry.field ).insert( entry.id, segments );
+
+    const QSharedPointer< Segment > segment = Segment::build( entries );
+    next->m_segmentFiles << addSegment( segment );
+    next->m_segments << segment;
+
+    writeManifest( *next );
+    publish( next );
+
+    if ( next->m_segments.count() > MAX_SEGMENTS )
+        merge();
+}
+
+
+void
+TrigramIndex::remove( const QList< int >& trackIds, const QList< int >& albumIds, const QList< int >& artistIds )
+{
+    const QSharedPointer< Snapshot > current = snapshot();
+    if ( current->m_segments.isEmpty() )
+        return;
+
+    QSharedPointer< Snapshot > next( new Snapshot( *current ) );
+
+    const int segments = current->m_segments.count();
+    foreach ( int id, trackIds )
+        next->m_deletedTracks.insert( id, segments );
+    foreach ( int id, albumIds )
+        next->m_deletedAlbums.insert( id, segments );
+    foreach ( int id, artistIds )
+        next->m_deletedArtists.insert( id, segments );
+
+    writeManifest( *next );
+    publish( next );
+}
+
+
+void
+TrigramIndex::merge()
+{
+    const QSharedPointer< Snapshot > current = snapshot();
+    if ( current->m_segments.count() < 2 && current->m_deletedTracks.isEmpty() &&
+         current->m_deletedAlbums.isEmpty() && current->m_deletedArtists.isEmpty() )
+        return;
+
+    QTime t;
+    t.start();
+
+    QList< Entry > entries;
+    for ( int s = 0; s < current->m_segments.count(); s++ )
+    {
+        foreach ( const Entry& entry, current->m_segments.at( s )->entries() )
+        {
+            if ( !current->isDeleted( entry.field, entry.id, s ) )
+                entries << entry;
+        }
+    }
+
+    reset( entries );
+    tDebug() << "Merged" << current->m_segments.count() << "trigram index segments in" << t.elapsed() << "ms";
+}
+
+
+void
+TrigramIndex::publish( const QSharedPointer< Snapshot >& snapshot )
+{
+    // searches still running on the old snapshot keep it alive until they're done
+    QMutexLocker lock( &m_snapshotMutex );
+    m_snapshot = snapshot;
+}
+
+
+QString
+TrigramIndex::addSegment( const QSharedPointer< Segment >& segment )
+{
+    const QString name = QString( "%1.segment" ).arg( m_nextSegment++ );
+    if ( !segment->save( QDir( m_path ).filePath( name ) ) )
+        tLog() << "Failed to save trigram index segment:" << name;
+
+    return name;
+}
+
+
+bool
+TrigramIndex::writeManifest( const Snapshot& snapshot )
+{
+    QDir dir( m_path );
+    const QString tmpName = QString( MANIFEST_NAME ) + ".tmp";
+
+    QFile file( dir.filePath( tmpName ) );
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+    {
+        tLog() << "Failed to write trigram index manifest:" << file.fileName();
+        return false;
+    }
+
+    QDataStream stream( &file );
+    stream << (quint32)MANIFEST_VERSION << (qint32)m_nextSegment
+           << snapshot.m_segmentFiles << snapshot.m_deletedTracks << snapshot.m_deletedAlbums << snapshot.m_deletedArtists;
+    file.close();
+
+    dir.remove( MANIFEST_NAME );
+    return dir.rename( tmpName, MANIFEST_NAME );
+}
+
+
+void
+TrigramIndex::removeUnusedFiles( const Snapshot& snapshot )
+{
+    // segments still mapped by older snapshots can't be removed on some platforms, that's retried next time
+    QDir dir( m_path );
+    foreach ( const QString& name, dir.entryList( QStringList() << "*.segment", QDir::Files ) )
+    {
+        if ( !snapshot.m_segmentFiles.contains( name ) )
+            dir.remove( name );
+    }
+}
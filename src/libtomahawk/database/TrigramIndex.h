@@ -0,0 +1,195 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2026, agent <agent@local>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRIGRAMINDEX_H
+#define TRIGRAMINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "DllMacro.h"
+
+class QFile;
+
+/*
+    An in-memory alternative to the Lucene index behind FuzzyIndex.
+
+    Every field value is split into trigrams. A search only compares the values
+    that share enough trigrams with the query, using an edit distance that gives
+    up as soon as it exceeds what the minimum similarity allows.
+
+    The index is made of immutable segments, laid out so they can be searched
+    right where they are: in memory after a change, or memory-mapped from disk
+    at startup. Changes add a small segment and mark the documents they replace
+    as deleted, until merge() combines everything into a single segment again.
+
+    Writes must be serialized by the caller. Searches run on a snapshot and
+    don't block each other or the writes.
+*/
+class DLLEXPORT TrigramIndex
+{
+public:
+    // track, artist & fulltext values belong to track documents, album and
+    // artist names to documents of their own
+    enum Field { TrackField = 0, ArtistField, FullTextField, AlbumField, ArtistNameField, FieldCount };
+
+    // a value of a document. The id is a track, album or artist id, depending on the field.
+    // stored isn't searched, it's kept with the value to be returned by searchNames()
+    struct Entry
+    {
+        Entry() : field( TrackField ), id( 0 ) {}
+        Entry( Field f, const QString& t, int i, const QString& s = QString() ) : field( f ), term( t ), id( i ), stored( s ) {}
+
+        Field field;
+        QString term;
+        int id;
+        QString stored;
+    };
+
+    /*
+        The values of a field are stored as sorted, distinct terms. A segment consists of
+        these arrays per field, each of them starting 8 byte aligned:
+
+            termOffsets     termCount + 1 offsets into chars
+            chars           the UTF-16 characters of all terms
+            trigrams        the sorted, distinct trigrams of all terms
+            postingOffsets  trigramCount + 1 offsets into postings
+            postings        the numbers of the terms containing each trigram
+            docOffsets      termCount + 1 offsets into docs
+            docs            the ids of the documents with each term
+            storedOffsets   docCount + 1 offsets into storedChars
+            storedChars     the UTF-16 characters of the stored values of all docs
+
+        The snapshots on disk are just a cache of the database, so they're stored in
+        the byte order of the machine.
+    */
+    class Segment
+    {
+    public:
+        struct FieldData
+        {
+            quint32 termCount;
+            quint32 trigramCount;
+            const quint32* termOffsets;
+            const ushort* chars;
+            const quint64* trigrams;
+            const quint32* postingOffsets;
+            const quint32* postings;
+            const quint32* docOffsets;
+            const qint32* docs;
+            const quint32* storedOffsets;
+            const ushort* storedChars;
+        };
+
+        static QSharedPointer< Segment > build( const QList< Entry >& entries );
+        // null if the file can't be read
+        static QSharedPointer< Segment > map( const QString& fileName );
+
+        ~Segment();
+
+        bool save( const QString& fileName ) const;
+
+        const FieldData& field( Field f ) const { return m_fields[ f ]; }
+        QList< Entry > entries() const;
+
+    private:
+        Segment() : m_file( 0 ), m_data( 0 ), m_size( 0 ) {}
+
+        bool parse( const uchar* data, qint64 size );
+
+        // a segment either owns its data, or it's mapped from m_file
+        QVector< quint64 > m_buffer;
+        QFile* m_file;
+        const uchar* m_data;
+        qint64 m_size;
+        FieldData m_fields[ FieldCount ];
+    };
+
+    class DLLEXPORT Snapshot
+    {
+    public:
+        // where the best value of a document was found, and how well it matched
+        struct Match
+        {
+            Match() : score( 0.0 ), segment( 0 ), doc( 0 ) {}
+
+            float score;
+            int segment;
+            quint32 doc;
+        };
+
+        // the similarity of every document with a value similar enough to term, by id
+        QHash< int, float > search( Field field, const QString& term ) const;
+        // like search(), but values starting with term match as well. Those score
+        // by how much of the value term covers, so the shortest ones come first.
+        // At most maxPrefixMatches documents are looked at for the values starting with term
+        QHash< int, Match > searchNames( Field field, const QString& term, uint maxPrefixMatches ) const;
+        QString stored( Field field, const Match& match ) const;
+
+    private:
+        friend class TrigramIndex;
+
+        void fuzzyMatches( Field field, const QString& term, QHash< int, Match >& matches ) const;
+        void prefixMatches( Field field, const QString& prefix, uint maxMatches, QHash< int, Match >& matches ) const;
+
+        bool isDeleted( Field field, int id, int segment ) const;
+        QHash< int, int >& deletedIds( Field field );
+
+        QList< QSharedPointer< Segment > > m_segments;
+        QStringList m_segmentFiles;
+        // documents with these ids are deleted from the segments before the given one
+        QHash< int, int > m_deletedTracks;
+        QHash< int, int > m_deletedAlbums;
+        QHash< int, int > m_deletedArtists;
+    };
+
+    // path is the directory the segments get stored in
+    explicit TrigramIndex( const QString& path );
+
+    // false until the index was either loaded from disk or built
+    bool exists() const { return m_exists; }
+    QSharedPointer< Snapshot > snapshot() const;
+
+    // replaces the whole index
+    void reset( const QList< Entry >& entries );
+    // replaces the documents with the ids of entries, if there are any
+    void update( const QList< Entry >& entries );
+    void remove( const QList< int >& trackIds, const QList< int >& albumIds, const QList< int >& artistIds );
+    void merge();
+
+private:
+    void load();
+    void publish( const QSharedPointer< Snapshot >& snapshot );
+    QString addSegment( const QSharedPointer< Segment >& segment );
+    bool writeManifest( const Snapshot& snapshot );
+    void removeUnusedFiles( const Snapshot& snapshot );
+
+    QString m_path;
+    bool m_exists;
+    int m_nextSegment;
+
+    mutable QMutex m_snapshotMutex;
+    QSharedPointer< Snapshot > m_snapshot;
+};
+
+#endif // TRIGRAMINDEX_H
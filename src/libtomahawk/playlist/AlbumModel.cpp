@@ -44,10 +44,41 @@ AlbumModel::AlbumModel( QObject* parent )
 
 AlbumModel::~AlbumModel()
 {
+    cancelPendingCommands();
     delete m_rootItem;
 }
 
 
+void
+AlbumModel::enqueueCommand( DatabaseCommand* cmd )
+{
+    // forget about commands that already ran
+    for ( int i = m_pendingCommands.count() - 1; i >= 0; i-- )
+    {
+        if ( m_pendingCommands.at( i ).isNull() )
+            m_pendingCommands.removeAt( i );
+    }
+
+    QSharedPointer<DatabaseCommand> cmdptr( cmd );
+    m_pendingCommands << cmdptr.toWeakRef();
+    Database::instance()->enqueue( cmdptr );
+}
+
+
+void
+AlbumModel::cancelPendingCommands()
+{
+    foreach ( const QWeakPointer<DatabaseCommand>& cmd, m_pendingCommands )
+    {
+        QSharedPointer<DatabaseCommand> cmdptr = cmd.toStrongRef();
+        if ( !cmdptr.isNull() )
+            cmdptr->cancel();
+    }
+
+    m_pendingCommands.clear();
+}
+
+
 QModelIndex
 AlbumModel::index( int row, int column, const QModelIndex& parent ) const
 {
@@ -252,7 +283,7 @@ AlbumModel::addCollection( const collection_ptr& collection, bool overwrite )
     connect( cmd, SIGNAL( albums( QList<Tomahawk::album_ptr>, QVariant ) ),
                     SLOT( addAlbums( QList<Tomahawk::album_ptr> ) ) );
 
-    Database::instance()->enqueue( QSharedPointer<DatabaseCommand>( cmd ) );
+    enqueueCommand( cmd );
 
     m_title = tr( "All albums from %1" ).arg( collection->source()->friendlyName() );
 
@@ -293,7 +324,7 @@ AlbumModel::addFilteredCollection( const collection_ptr& collection, unsigned in
     connect( cmd, SIGNAL( albums( QList<Tomahawk::album_ptr>, QVariant ) ),
                     SLOT( addAlbums( QList<Tomahawk::album_ptr> ) ) );
 
-    Database::instance()->enqueue( QSharedPointer<DatabaseCommand>( cmd ) );
+    enqueueCommand( cmd );
 
     if ( !collection.isNull() )
         m_title = tr( "All albums from %1" ).arg( collection->source()->friendlyName() );
@@ -112,6 +112,10 @@ private slots:
     void onCollectionChanged();
 
 private:
+    // the queries this model is still waiting for. They are canceled when it goes away
+    void enqueueCommand( DatabaseCommand* cmd );
+    void cancelPendingCommands();
+
     QPersistentModelIndex m_currentIndex;
     PlayableItem* m_rootItem;
 
@@ -122,6 +126,7 @@ private:
     QSize m_itemSize;
 
     Tomahawk::collection_ptr m_collection;
+    QList< QWeakPointer<DatabaseCommand> > m_pendingCommands;
 };
 
 #endif // ALBUMMODEL_H
@@ -23,6 +23,8 @@
 #include "PlayableItem.h"
 #include "utils/Logger.h"
 
+#define TRACKS_PER_BATCH 500
+
 using namespace Tomahawk;
 
 
@@ -61,9 +63,13 @@ CollectionFlatModel::addCollection( const collection_ptr& collection, bool sendN
     if ( sendNotifications )
         emit loadingStarted();
 
+    // show the first tracks right away instead of waiting for the entire collection
     DatabaseCommand_AllTracks* cmd = new DatabaseCommand_AllTracks( collection );
+    cmd->setBatchSize( TRACKS_PER_BATCH );
     connect( cmd, SIGNAL( tracks( QList<Tomahawk::query_ptr>, QVariant ) ),
                     SLOT( onTracksAdded( QList<Tomahawk::query_ptr> ) ), Qt::QueuedConnection );
+    connect( cmd, SIGNAL( done( Tomahawk::collection_ptr ) ),
+                    SLOT( onCollectionLoaded( Tomahawk::collection_ptr ) ), Qt::QueuedConnection );
 
     Database::instance()->enqueue( QSharedPointer<DatabaseCommand>( cmd ) );
 
@@ -114,6 +120,18 @@ CollectionFlatModel::onTracksAdded( const QList<Tomahawk::query_ptr>& tracks )
 }
 
 
+void
+CollectionFlatModel::onCollectionLoaded( const Tomahawk::collection_ptr& collection )
+{
+    if ( !m_loadingCollections.contains( collection.data() ) )
+        return;
+
+    m_loadingCollections.removeAll( collection.data() );
+    if ( m_loadingCollections.isEmpty() )
+        emit loadingFinished();
+}
+
+
 void
 CollectionFlatModel::onTracksRemoved( const QList<Tomahawk::query_ptr>& tracks )
 {
@@ -60,6 +60,7 @@ signals:
 
 private slots:
     void onTracksAdded( const QList<Tomahawk::query_ptr>& tracks );
+    void onCollectionLoaded( const Tomahawk::collection_ptr& collection );
     void onTracksRemoved( const QList<Tomahawk::query_ptr>& tracks );
 
 private:
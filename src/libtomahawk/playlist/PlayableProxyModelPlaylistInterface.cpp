@@ -181,6 +181,47 @@ PlayableProxyModelPlaylistInterface::siblingItem( int itemsAway, bool readOnly )
 }
 
 
+QList< Tomahawk::query_ptr >
+PlayableProxyModelPlaylistInterface::upcomingQueries( int count )
+{
+    QList< Tomahawk::query_ptr > queries;
+    if ( m_proxyModel.isNull() || m_shuffled )
+        return queries;
+
+    PlayableProxyModel* proxyModel = m_proxyModel.data();
+    const int rows = proxyModel->rowCount();
+    if ( !rows )
+        return queries;
+
+    int row = 0;
+    if ( proxyModel->currentIndex().isValid() )
+    {
+        row = proxyModel->currentIndex().row();
+        if ( m_repeatMode == PlaylistModes::RepeatOne )
+            return queries;
+
+        row++;
+    }
+
+    for ( int i = 0; i < rows && queries.count() < count; i++, row++ )
+    {
+        if ( row >= rows )
+        {
+            if ( m_repeatMode != PlaylistModes::RepeatAll )
+                break;
+
+            row = 0;
+        }
+
+        PlayableItem* item = proxyModel->itemFromIndex( proxyModel->mapToSource( proxyModel->index( row, 0 ) ) );
+        if ( item && !item->query().isNull() )
+            queries << item->query();
+    }
+
+    return queries;
+}
+
+
 Tomahawk::result_ptr
 PlayableProxyModelPlaylistInterface::currentItem() const
 {
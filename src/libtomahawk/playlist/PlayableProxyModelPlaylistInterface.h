@@ -47,6 +47,7 @@ public:
     virtual Tomahawk::result_ptr currentItem() const;
     virtual Tomahawk::result_ptr siblingItem( int itemsAway );
     virtual Tomahawk::result_ptr siblingItem( int itemsAway, bool readOnly );
+    virtual QList< Tomahawk::query_ptr > upcomingQueries( int count );
     virtual bool hasNextItem();
 
     virtual QString filter() const;
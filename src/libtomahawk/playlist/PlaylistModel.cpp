@@ -251,7 +251,8 @@ PlaylistModel::insert( const QList< Tomahawk::plentry_ptr >& entries, int row )
 
     if ( !m_waitingForResolved.isEmpty() )
     {
-        Pipeline::instance()->resolve( queries );
+        // the view bumps the visible rows, everything else resolves in the background
+        Pipeline::instance()->resolve( queries, Tomahawk::ResolvePriority::Background );
         emit loadingStarted();
     }
 
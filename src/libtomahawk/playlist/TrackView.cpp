@@ -38,6 +38,7 @@
 #include "Artist.h"
 #include "Album.h"
 #include "Source.h"
+#include "Pipeline.h"
 #include "utils/AnimatedSpinner.h"
 
 #define SCROLL_TIMEOUT 280
@@ -174,9 +175,6 @@ TrackView::setPlayableModel( PlayableModel* model )
 void
 TrackView::onViewChanged()
 {
-    if ( m_model->style() != PlayableModel::Short && m_model->style() != PlayableModel::Large ) // eventual FIXME?
-        return;
-
     if ( m_timer.isActive() )
         m_timer.stop();
 
@@ -205,9 +203,18 @@ TrackView::onScrollTimeout()
     if ( !max )
         return;
 
+    const bool detailed = ( m_model->style() == PlayableModel::Short || m_model->style() == PlayableModel::Large ); // eventual FIXME?
     for ( int i = left.row(); i <= max; i++ )
     {
-        m_model->updateDetailedInfo( m_proxyModel->mapToSource( m_proxyModel->index( i, 0 ) ) );
+        const QModelIndex index = m_proxyModel->mapToSource( m_proxyModel->index( i, 0 ) );
+
+        // resolve what the user is looking at first, without demoting what's about to be played
+        PlayableItem* item = m_model->itemFromIndex( index );
+        if ( item && !item->query().isNull() )
+            Pipeline::instance()->promote( item->query(), Tomahawk::ResolvePriority::Visible );
+
+        if ( detailed )
+            m_model->updateDetailedInfo( index );
     }
 }
 
@@ -59,10 +59,41 @@ TreeModel::~TreeModel()
 {
     tDebug() << Q_FUNC_INFO;
     
+    cancelPendingCommands();
     delete m_rootItem;
 }
 
 
+void
+TreeModel::enqueueCommand( DatabaseCommand* cmd )
+{
+    // forget about commands that already ran
+    for ( int i = m_pendingCommands.count() - 1; i >= 0; i-- )
+    {
+        if ( m_pendingCommands.at( i ).isNull() )
+            m_pendingCommands.removeAt( i );
+    }
+
+    QSharedPointer<DatabaseCommand> cmdptr( cmd );
+    m_pendingCommands << cmdptr.toWeakRef();
+    Database::instance()->enqueue( cmdptr );
+}
+
+
+void
+TreeModel::cancelPendingCommands()
+{
+    foreach ( const QWeakPointer<DatabaseCommand>& cmd, m_pendingCommands )
+    {
+        QSharedPointer<DatabaseCommand> cmdptr = cmd.toStrongRef();
+        if ( !cmdptr.isNull() )
+            cmdptr->cancel();
+    }
+
+    m_pendingCommands.clear();
+}
+
+
 void
 TreeModel::clear()
 {
@@ -577,7 +608,7 @@ TreeModel::addAllCollections()
     connect( cmd, SIGNAL( artists( QList<Tomahawk::artist_ptr> ) ),
                     SLOT( onArtistsAdded( QList<Tomahawk::artist_ptr> ) ) );
 
-    Database::instance()->enqueue( QSharedPointer<DatabaseCommand>( cmd ) );
+    enqueueCommand( cmd );
 
     connect( SourceList::instance(), SIGNAL( sourceAdded( Tomahawk::source_ptr ) ), SLOT( onSourceAdded( Tomahawk::source_ptr ) ), Qt::UniqueConnection );
 
@@ -694,7 +725,7 @@ TreeModel::addCollection( const collection_ptr& collection )
     connect( cmd, SIGNAL( artists( QList<Tomahawk::artist_ptr> ) ),
                     SLOT( onArtistsAdded( QList<Tomahawk::artist_ptr> ) ) );
 
-    Database::instance()->enqueue( QSharedPointer<DatabaseCommand>( cmd ) );
+    enqueueCommand( cmd );
 
     connect( collection.data(), SIGNAL( changed() ), SLOT( onCollectionChanged() ), Qt::UniqueConnection );
 
@@ -724,7 +755,7 @@ TreeModel::addFilteredCollection( const collection_ptr& collection, unsigned int
     connect( cmd, SIGNAL( artists( QList<Tomahawk::artist_ptr>, Tomahawk::collection_ptr ) ),
                     SLOT( onArtistsAdded( QList<Tomahawk::artist_ptr>, Tomahawk::collection_ptr ) ) );
 
-    Database::instance()->enqueue( QSharedPointer<DatabaseCommand>( cmd ) );
+    enqueueCommand( cmd );
 
     if ( collection->source()->isLocal() )
         setTitle( tr( "My Collection" ) );
@@ -165,6 +165,10 @@ private slots:
     void onCollectionChanged();
 
 private:
+    // the queries this model is still waiting for. They are canceled when it goes away
+    void enqueueCommand( DatabaseCommand* cmd );
+    void cancelPendingCommands();
+
     QPersistentModelIndex m_currentIndex;
     PlayableItem* m_rootItem;
     QString m_infoId;
@@ -178,6 +182,7 @@ private:
     QList<Tomahawk::artist_ptr> m_artistsFilter;
 
     Tomahawk::collection_ptr m_collection;
+    QList< QWeakPointer<DatabaseCommand> > m_pendingCommands;
     QList<Tomahawk::InfoSystem::InfoStringHash> m_receivedInfoData;
 };
 
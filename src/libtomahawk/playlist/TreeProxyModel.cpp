@@ -25,7 +25,6 @@
 #include "Source.h"
 #include "Query.h"
 #include "database/Database.h"
-#include "database/DatabaseImpl.h"
 #include "database/DatabaseCommand_AllAlbums.h"
 #include "PlayableItem.h"
 #include "utils/Logger.h"
@@ -33,7 +32,6 @@
 
 TreeProxyModel::TreeProxyModel( QObject* parent )
     : QSortFilterProxyModel( parent )
-    , m_artistsFilterCmd( 0 )
     , m_model( 0 )
 {
     setFilterCaseSensitivity( Qt::CaseInsensitive );
@@ -121,12 +119,15 @@ TreeProxyModel::newFilterFromPlaylistInterface( const QString &pattern )
     m_filter = pattern;
     m_albumsFilter.clear();
 
-    if ( m_artistsFilterCmd )
+    QSharedPointer<DatabaseCommand> staleCmd = m_artistsFilterCmd.toStrongRef();
+    if ( !staleCmd.isNull() )
     {
-        disconnect( m_artistsFilterCmd, SIGNAL( artists( QList<Tomahawk::artist_ptr> ) ),
-                    this,                 SLOT( onFilterArtists( QList<Tomahawk::artist_ptr> ) ) );
+        // nobody is interested in the results of the previous filter anymore
+        disconnect( staleCmd.data(), SIGNAL( artists( QList<Tomahawk::artist_ptr> ) ),
+                    this,              SLOT( onFilterArtists( QList<Tomahawk::artist_ptr> ) ) );
 
-        m_artistsFilterCmd = 0;
+        staleCmd->cancel();
+        m_artistsFilterCmd.clear();
     }
 
     if ( m_filter.isEmpty() )
@@ -137,12 +138,13 @@ TreeProxyModel::newFilterFromPlaylistInterface( const QString &pattern )
     {
         DatabaseCommand_AllArtists* cmd = new DatabaseCommand_AllArtists( m_model->collection() );
         cmd->setFilter( pattern );
-        m_artistsFilterCmd = cmd;
 
         connect( cmd, SIGNAL( artists( QList<Tomahawk::artist_ptr> ) ),
                         SLOT( onFilterArtists( QList<Tomahawk::artist_ptr> ) ) );
 
-        Database::instance()->enqueue( QSharedPointer<DatabaseCommand>( cmd ) );
+        QSharedPointer<DatabaseCommand> cmdptr( cmd );
+        m_artistsFilterCmd = cmdptr.toWeakRef();
+        Database::instance()->enqueue( cmdptr );
     }
 }
 
@@ -152,7 +154,7 @@ TreeProxyModel::onFilterArtists( const QList<Tomahawk::artist_ptr>& artists )
 {
     bool finished = true;
     m_artistsFilter = artists;
-    m_artistsFilterCmd = 0;
+    m_artistsFilterCmd.clear();
 
     foreach ( const Tomahawk::artist_ptr& artist, artists )
     {
@@ -190,7 +192,7 @@ TreeProxyModel::onFilterAlbums( const QList<Tomahawk::album_ptr>& albums )
 void
 TreeProxyModel::filterFinished()
 {
-    m_artistsFilterCmd = 0;
+    m_artistsFilterCmd.clear();
 
     if ( qobject_cast< Tomahawk::TreeProxyModelPlaylistInterface* >( m_playlistInterface.data() )->vanillaFilter() != m_filter )
     {
@@ -378,11 +380,11 @@ TreeProxyModel::textForItem( PlayableItem* item ) const
     }
     else if ( !item->album().isNull() )
     {
-        return DatabaseImpl::sortname( item->album()->name() );
+        return item->album()->sortname();
     }
     else if ( !item->result().isNull() )
     {
-        return DatabaseImpl::sortname( item->result()->track() );
+        return item->result()->trackSortname();
     }
     else if ( !item->query().isNull() )
     {
@@ -27,7 +27,7 @@
 
 #include "DllMacro.h"
 
-class DatabaseCommand_AllArtists;
+class DatabaseCommand;
 
 namespace Tomahawk
 {
@@ -85,7 +85,7 @@ private:
 
     QList<Tomahawk::artist_ptr> m_artistsFilter;
     QList<int> m_albumsFilter;
-    DatabaseCommand_AllArtists* m_artistsFilterCmd;
+    QWeakPointer<DatabaseCommand> m_artistsFilterCmd;
 
      QString m_filter;
 
@@ -0,0 +1,223 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2026, agent <agent@local>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "EditDistance.h"
+
+#include <QThreadStorage>
+#include <QVector>
+
+// longest string we can handle with a single 64-bit word per column
+#define MAX_BITPARALLEL_LENGTH 64
+
+
+// reused by every call on the same thread, so comparing doesn't allocate
+struct EditDistanceBuffer
+{
+    EditDistanceBuffer()
+    {
+        for ( int i = 0; i < 256; i++ )
+            latin1Masks[ i ] = 0;
+    }
+
+    quint64 latin1Masks[ 256 ];
+    QVector< int > rows;
+};
+
+static QThreadStorage< EditDistanceBuffer* > s_buffers;
+
+
+static EditDistanceBuffer*
+buffer()
+{
+    if ( !s_buffers.hasLocalData() )
+        s_buffers.setLocalData( new EditDistanceBuffer );
+
+    return s_buffers.localData();
+}
+
+
+/*
+    Bit-parallel algorithm by Myers, with Hyyro's extension for transpositions.
+    One column of the matrix is kept in a few bit vectors, so the pattern
+    can't be longer than MAX_BITPARALLEL_LENGTH.
+*/
+static int
+bitParallelDistance( const ushort* pattern, int m, const ushort* text, int n, int maxDistance, EditDistanceBuffer* buffer )
+{
+    // match masks: bit i is set where the pattern has this character at position i
+    ushort otherChars[ MAX_BITPARALLEL_LENGTH ];
+    quint64 otherMasks[ MAX_BITPARALLEL_LENGTH ];
+    int others = 0;
+    for ( int i = 0; i < m; i++ )
+    {
+        const ushort c = pattern[ i ];
+        if ( c < 256 )
+        {
+            buffer->latin1Masks[ c ] |= Q_UINT64_C( 1 ) << i;
+            continue;
+        }
+
+        int k = 0;
+        while ( k < others && otherChars[ k ] != c )
+            k++;
+        if ( k == others )
+        {
+            otherChars[ others ] = c;
+            otherMasks[ others++ ] = 0;
+        }
+        otherMasks[ k ] |= Q_UINT64_C( 1 ) << i;
+    }
+
+    const quint64 last = Q_UINT64_C( 1 ) << ( m - 1 );
+    quint64 pv = ~Q_UINT64_C( 0 );
+    quint64 mv = 0;
+    quint64 d0 = 0;
+    quint64 prevEq = 0;
+    int score = m;
+
+    for ( int j = 0; j < n; j++ )
+    {
+        const ushort c = text[ j ];
+        quint64 eq = 0;
+        if ( c < 256 )
+        {
+            eq = buffer->latin1Masks[ c ];
+        }
+        else
+        {
+            for ( int k = 0; k < others; k++ )
+            {
+                if ( otherChars[ k ] == c )
+                {
+                    eq = otherMasks[ k ];
+                    break;
+                }
+            }
+        }
+
+        // transpositions, but not within the first two characters of either string
+        quint64 tr = 0;
+        if ( j >= 2 )
+            tr = ( ( ( ~d0 ) & eq ) << 1 ) & prevEq & ~Q_UINT64_C( 3 );
+
+        d0 = ( ( ( eq & pv ) + pv ) ^ pv ) | eq | mv | tr;
+        quint64 hp = mv | ~( d0 | pv );
+        const quint64 hn = d0 & pv;
+
+        if ( hp & last )
+            score++;
+        else if ( hn & last )
+            score--;
+
+        hp = ( hp << 1 ) | 1;
+        pv = ( hn << 1 ) | ~( d0 | hp );
+        mv = hp & d0;
+        prevEq = eq;
+
+        // every remaining character can lower the score by one at most
+        if ( maxDistance >= 0 && score - ( n - j - 1 ) > maxDistance )
+        {
+            score -= n - j - 1;
+            break;
+        }
+    }
+
+    for ( int i = 0; i < m; i++ )
+    {
+        if ( pattern[ i ] < 256 )
+            buffer->latin1Masks[ pattern[ i ] ] = 0;
+    }
+
+    return score;
+}
+
+
+static int
+matrixDistance( const ushort* source, int n, const ushort* target, int m, int maxDistance, EditDistanceBuffer* buffer )
+{
+    // three rows of the matrix are enough, transpositions look back two rows
+    buffer->rows.resize( 3 * ( m + 1 ) );
+    int* prev2 = buffer->rows.data();
+    int* prev = prev2 + m + 1;
+    int* cur = prev + m + 1;
+
+    for ( int j = 0; j <= m; j++ )
+        prev[ j ] = j;
+    int prevMin = 0;
+
+    for ( int i = 1; i <= n; i++ )
+    {
+        const ushort s_i = source[ i - 1 ];
+        cur[ 0 ] = i;
+        int rowMin = i;
+
+        for ( int j = 1; j <= m; j++ )
+        {
+            const ushort t_j = target[ j - 1 ];
+            const int cost = ( s_i == t_j ) ? 0 : 1;
+
+            int cell = qMin( cur[ j - 1 ] + 1, prev[ j - 1 ] + cost );
+            cell = qMin( cell, prev[ j ] + 1 );
+
+            if ( i > 2 && j > 2 && s_i == target[ j - 2 ] && source[ i - 2 ] == t_j )
+                cell = qMin( cell, prev2[ j - 2 ] + 1 );
+
+            cur[ j ] = cell;
+            rowMin = qMin( rowMin, cell );
+        }
+
+        // every path to the end passes one of these two rows
+        if ( maxDistance >= 0 && rowMin > maxDistance && prevMin > maxDistance )
+            return qMin( rowMin, prevMin );
+
+        prevMin = rowMin;
+        int* tmp = prev2;
+        prev2 = prev;
+        prev = cur;
+        cur = tmp;
+    }
+
+    return prev[ m ];
+}
+
+
+int
+TomahawkUtils::editDistance( const QString& source, const QString& target, int maxDistance )
+{
+    return editDistance( source.utf16(), source.length(), target.utf16(), target.length(), maxDistance );
+}
+
+
+int
+TomahawkUtils::editDistance( const ushort* s, int n, const ushort* t, int m, int maxDistance )
+{
+    if ( n == 0 )
+        return m;
+    if ( m == 0 )
+        return n;
+    if ( maxDistance >= 0 && qAbs( n - m ) > maxDistance )
+        return qAbs( n - m );
+
+    // the distance is symmetric, so use the shorter string as the bit pattern
+    if ( n <= m && n <= MAX_BITPARALLEL_LENGTH )
+        return bitParallelDistance( s, n, t, m, maxDistance, buffer() );
+    if ( m < n && m <= MAX_BITPARALLEL_LENGTH )
+        return bitParallelDistance( t, m, s, n, maxDistance, buffer() );
+
+    return matrixDistance( s, n, t, m, maxDistance, buffer() );
+}
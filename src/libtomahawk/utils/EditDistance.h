@@ -0,0 +1,40 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2026, agent <agent@local>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EDITDISTANCE_H
+#define EDITDISTANCE_H
+
+#include <QString>
+
+#include "DllMacro.h"
+
+namespace TomahawkUtils
+{
+    /**
+     * Edit distance between two strings, counting insertions, deletions, substitutions
+     * and transpositions of adjacent characters (except within the first two characters).
+     *
+     * If maxDistance is not negative, calculation stops as soon as the distance is known
+     * to exceed it. A lower bound of the distance, larger than maxDistance, is returned then.
+     */
+    DLLEXPORT int editDistance( const QString& source, const QString& target, int maxDistance = -1 );
+    // for UTF-16 data that doesn't live in a QString
+    DLLEXPORT int editDistance( const ushort* source, int sourceLength, const ushort* target, int targetLength, int maxDistance = -1 );
+}
+
+#endif // EDITDISTANCE_H
@@ -33,7 +33,8 @@ using namespace Tomahawk;
 
 QString SocialPlaylistWidget::s_popularAlbumsQuery = "SELECT * from album";
 QString SocialPlaylistWidget::s_mostPlayedPlaylistsQuery = "asd";
-QString SocialPlaylistWidget::s_topForeignTracksQuery = "select track.name, artist.name, count(*) as counter from (select track from playback_log group by track, source), track, artist where track not in (select track from playback_log where source is null group by track) and track.id = track and artist.id = track.artist group by track order by counter desc";
+// tracks played by the most friends, that we haven't played ourselves. playback_stats has one row per source and track
+QString SocialPlaylistWidget::s_topForeignTracksQuery = "select track.name, artist.name, count(*) as counter from playback_stats, track, artist where playback_stats.source is not null and playback_stats.track not in (select track from playback_stats where source is null) and track.id = playback_stats.track and artist.id = track.artist group by playback_stats.track order by counter desc";
 
 SocialPlaylistWidget::SocialPlaylistWidget ( QWidget* parent )
     : QWidget( parent )